@@ -32,19 +32,85 @@
  * Class constructor / destructor methods
  */
 
+/* private method */
+static pygear_task_context* _pygear_task_context_new(pygear_ClientObject* client) {
+    pygear_task_context* context = malloc(sizeof(pygear_task_context));
+    if (!context) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    context->client = client;
+    context->has_workload = 0;
+    context->next = NULL;
+    context->add_task = NULL;
+    context->function_name = NULL;
+    context->unique = NULL;
+    context->task = NULL;
+    context->background = 0;
+    context->finished = 0;
+    context->quiet = 0;
+    context->future = NULL;
+    return context;
+}
+
+/* private method */
+static void _pygear_task_context_release_workload(pygear_task_context* context) {
+    if (context->has_workload) {
+        // Tasks can be freed from inside run_tasks, where the GIL is released
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        PyBuffer_Release(&context->workload);
+        PyGILState_Release(gstate);
+        context->has_workload = 0;
+    }
+}
+
+/* private method, installed as the gearman_task_context_free_fn */
+static void _pygear_task_context_free(gearman_task_st* gear_task, void* context) {
+    pygear_task_context* task_context = (pygear_task_context*) context;
+    if (!task_context) {
+        return;
+    }
+    _pygear_task_context_release_workload(task_context);
+    if (task_context->future) {
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        Py_CLEAR(task_context->future);
+        PyGILState_Release(gstate);
+    }
+    free(task_context->function_name);
+    free(task_context->unique);
+    free(task_context);
+}
+
+/* private method, the pygear_wait_fn of the client's waiter */
+static gearman_return_t _pygear_client_wait(void* handle, int timeout) {
+    gearman_client_st* g_client = (gearman_client_st*) handle;
+    int client_timeout = gearman_client_timeout(g_client);
+    gearman_client_set_timeout(g_client, timeout);
+    gearman_return_t result = gearman_client_wait(g_client);
+    gearman_client_set_timeout(g_client, client_timeout);
+    return result;
+}
+
 int Client_init(pygear_ClientObject* self, PyObject* args, PyObject*kwds) {
     self->g_Client = gearman_client_create(NULL);
-    self->serializer = PyImport_ImportModule(PYTHON_SERIALIZER);
-    if (self->serializer == NULL) {
-        PyObject* err_string = PyString_FromFormat("Failed to import '%s'", PYTHON_SERIALIZER);
-        PyErr_SetObject(PyExc_ImportError, err_string);
-        Py_XDECREF(err_string);
+    self->serializer = _pygear_default_serializer();
+    self->codec = NULL;
+    self->typed_arrays = 0;
+    self->compression = _pygear_compression_off;
+    self->compression_map = PyDict_New();
+    if (self->serializer == NULL || self->compression_map == NULL) {
         return -1;
     }
     if (self->g_Client == NULL) {
         PyErr_SetString(PyGearExn_ERROR, "Failed to create internal gearman client structure");
         return -1;
     }
+    gearman_client_set_task_context_free_fn(self->g_Client, _pygear_task_context_free);
+    _pygear_client_set_tracking_fn(self->g_Client);
+    _pygear_waiter_init(&self->waiter, _pygear_client_wait, self->g_Client);
+    self->pending = NULL;
+    self->pending_tail = NULL;
+    self->submitted = NULL;
     // Callbacks
     self->cb_workload = NULL;
     self->cb_created = NULL;
@@ -58,6 +124,14 @@ int Client_init(pygear_ClientObject* self, PyObject* args, PyObject*kwds) {
 }
 
 int Client_traverse(pygear_ClientObject* self, visitproc visit, void* arg) {
+    // Futures of queued tasks refer back to the client
+    pygear_task_context* context;
+    for (context = self->pending; context; context = context->next) {
+        Py_VISIT(context->future);
+    }
+    for (context = self->submitted; context; context = context->next) {
+        Py_VISIT(context->future);
+    }
     Py_VISIT(self->cb_workload);
     Py_VISIT(self->cb_created);
     Py_VISIT(self->cb_data);
@@ -68,10 +142,18 @@ int Client_traverse(pygear_ClientObject* self, visitproc visit, void* arg) {
     Py_VISIT(self->cb_fail);
     Py_VISIT(self->cb_log);
     Py_VISIT(self->serializer);
+    Py_VISIT(self->compression_map);
     return 0;
 }
 
 int Client_clear(pygear_ClientObject* self) {
+    pygear_task_context* context;
+    for (context = self->pending; context; context = context->next) {
+        Py_CLEAR(context->future);
+    }
+    for (context = self->submitted; context; context = context->next) {
+        Py_CLEAR(context->future);
+    }
     Py_CLEAR(self->cb_workload);
     Py_CLEAR(self->cb_created);
     Py_CLEAR(self->cb_data);
@@ -82,10 +164,20 @@ int Client_clear(pygear_ClientObject* self) {
     Py_CLEAR(self->cb_fail);
     Py_CLEAR(self->cb_log);
     Py_CLEAR(self->serializer);
+    Py_CLEAR(self->compression_map);
     return 0;
 }
 
 void Client_dealloc(pygear_ClientObject* self) {
+    _pygear_waiter_free(&self->waiter);
+    // Submitted tasks belong to libgearman, pending ones are still ours
+    while (self->pending) {
+        pygear_task_context* context = self->pending;
+        self->pending = context->next;
+        _pygear_task_context_free(NULL, context);
+    }
+    self->pending_tail = NULL;
+    self->submitted = NULL;
     if (self->g_Client) {
         gearman_client_free(self->g_Client);
         self->g_Client = NULL;
@@ -149,6 +241,235 @@ static PyObject* pygear_client_add_servers(pygear_ClientObject* self, PyObject*
 }
 
 
+pygear_add_task_fn _pygear_add_task_fn(int priority, int background) {
+    switch (priority) {
+        case GEARMAN_JOB_PRIORITY_HIGH:
+            return background ? gearman_client_add_task_high_background : gearman_client_add_task_high;
+        case GEARMAN_JOB_PRIORITY_NORMAL:
+            return background ? gearman_client_add_task_background : gearman_client_add_task;
+        case GEARMAN_JOB_PRIORITY_LOW:
+            return background ? gearman_client_add_task_low_background : gearman_client_add_task_low;
+    }
+    PyErr_SetString(PyExc_ValueError,
+        "priority must be PYGEAR_PRIORITY_HIGH, PYGEAR_PRIORITY_NORMAL or PYGEAR_PRIORITY_LOW");
+    return NULL;
+}
+
+/* private method */
+static char* _pygear_strdup(const char* str) {
+    if (!str) {
+        return NULL;
+    }
+    char* copy = malloc(strlen(str) + 1);
+    if (copy) {
+        strcpy(copy, str);
+    }
+    return copy;
+}
+
+pygear_task_context* _pygear_task_context_prepare(pygear_ClientObject* self,
+    pygear_add_task_fn add_task, const char* function_name, const char* unique, PyObject* workload,
+    const pygear_compression_t* compression) {
+
+    // Export the workload; the task holds on to it until the job server has
+    // acknowledged it, since nothing is sent until client_run_tasks() is called
+    pygear_task_context* context = _pygear_task_context_new(self);
+    if (!context) {
+        return NULL;
+    }
+    context->add_task = add_task;
+    context->background = (add_task == gearman_client_add_task_background ||
+                           add_task == gearman_client_add_task_high_background ||
+                           add_task == gearman_client_add_task_low_background);
+    context->function_name = _pygear_strdup(function_name);
+    context->unique = _pygear_strdup(unique);
+    if (!context->function_name || (unique && !context->unique)) {
+        _pygear_task_context_free(NULL, context);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    if (_pygear_serialize(self->serializer, self->codec, self->typed_arrays, workload, &context->workload) == -1) {
+        _pygear_task_context_free(NULL, context);
+        return NULL;
+    }
+    context->has_workload = 1;
+    if (_pygear_compress(self->serializer, compression, &context->workload) == -1) {
+        _pygear_task_context_free(NULL, context);
+        return NULL;
+    }
+    return context;
+}
+
+gearman_task_st* _pygear_client_submit(gearman_client_st* g_client, pygear_task_context* context) {
+    gearman_return_t ret;
+    gearman_task_st* new_task = context->add_task(
+        g_client,
+        NULL, /* task */
+        NULL, /* context, attached once the task exists */
+        context->function_name,
+        context->unique,
+        context->workload.buf,
+        context->workload.len,
+        &ret
+    );
+    if (_pygear_check_and_raise_exn(ret)) {
+        if (context->future) {
+            // Fail the future of the job that was never sent; that takes the
+            // exception over, so raise it again for the caller
+            _pygear_future_abandon(context->future, ret);
+            _pygear_check_and_raise_exn(ret);
+        }
+        _pygear_task_context_free(NULL, context);
+        return NULL;
+    }
+    gearman_task_set_context(new_task, context);
+    context->task = new_task;
+    return new_task;
+}
+
+/* private method */
+static void _pygear_client_defer(pygear_ClientObject* self, pygear_task_context* context) {
+    if (self->pending_tail) {
+        self->pending_tail->next = context;
+    } else {
+        self->pending = context;
+    }
+    self->pending_tail = context;
+}
+
+Py_ssize_t _pygear_client_submit_pending(pygear_ClientObject* self, Py_ssize_t in_flight,
+    Py_ssize_t limit) {
+    while (self->pending && (limit < 0 || in_flight < limit)) {
+        pygear_task_context* context = self->pending;
+        self->pending = context->next;
+        if (!self->pending) {
+            self->pending_tail = NULL;
+        }
+        context->next = NULL;
+        // A task libgearman refuses is dropped rather than retried forever
+        if (!_pygear_client_submit(self->g_Client, context)) {
+            return -1;
+        }
+        context->next = self->submitted;
+        self->submitted = context;
+        ++in_flight;
+    }
+    return in_flight;
+}
+
+Py_ssize_t _pygear_client_sweep_tasks(pygear_ClientObject* self, int all_done) {
+    Py_ssize_t in_flight = 0;
+    pygear_task_context** link = &self->submitted;
+    while (*link) {
+        pygear_task_context* context = *link;
+        if (all_done || context->finished) {
+            *link = context->next;
+            if (context->future) {
+                _pygear_future_abandon(context->future, gearman_task_return(context->task));
+            }
+            // Frees the context through _pygear_task_context_free
+            gearman_task_free(context->task);
+        } else {
+            ++in_flight;
+            link = &context->next;
+        }
+    }
+    return in_flight;
+}
+
+Py_ssize_t _pygear_client_queue_tasks(pygear_ClientObject* self, gearman_client_st* g_client,
+    pygear_add_task_fn add_task, const char* function_name, PyObject* workloads, PyObject* uniques,
+    gearman_task_st*** tasks) {
+
+    PyObject* workload_seq = PySequence_Fast(workloads, "workloads must be iterable");
+    if (!workload_seq) {
+        return -1;
+    }
+    // Where the contexts deferred by this call start, should it fail
+    pygear_task_context* old_tail = self->pending_tail;
+    PyObject* unique_seq = NULL;
+    Py_ssize_t i = 0, num_tasks = PySequence_Fast_GET_SIZE(workload_seq);
+    if (uniques != Py_None) {
+        unique_seq = PySequence_Fast(uniques, "uniques must be iterable");
+        if (!unique_seq) {
+            goto error;
+        }
+        if (PySequence_Fast_GET_SIZE(unique_seq) != num_tasks) {
+            PyErr_SetString(PyExc_ValueError, "uniques must have one entry per workload");
+            goto error;
+        }
+    }
+    if (tasks) {
+        *tasks = PyMem_New(gearman_task_st*, num_tasks ? num_tasks : 1);
+        if (!*tasks) {
+            PyErr_NoMemory();
+            goto error;
+        }
+    }
+    pygear_compression_t compression;
+    _pygear_compression_for(self->compression_map, &self->compression, function_name, &compression);
+
+    for (i = 0; i < num_tasks; ++i) {
+        char* unique = NULL;
+        if (unique_seq) {
+            PyObject* py_unique = PySequence_Fast_GET_ITEM(unique_seq, i);
+            if (py_unique != Py_None && !(unique = PyString_AsString(py_unique))) {
+                goto error;
+            }
+        }
+        PyObject* workload = PySequence_Fast_GET_ITEM(workload_seq, i);
+        pygear_task_context* context = _pygear_task_context_prepare(self, add_task,
+            function_name, unique, workload, &compression);
+        if (!context) {
+            goto error;
+        }
+        if (!g_client) {
+            _pygear_client_defer(self, context);
+            continue;
+        }
+        context->quiet = 1;
+        gearman_task_st* new_task = _pygear_client_submit(g_client, context);
+        if (!new_task) {
+            goto error;
+        }
+        if (tasks) {
+            (*tasks)[i] = new_task;
+        }
+    }
+    Py_DECREF(workload_seq);
+    Py_XDECREF(unique_seq);
+    return num_tasks;
+
+error:
+    if (tasks && *tasks) {
+        // The tasks created so far would otherwise go out with the next run
+        while (i > 0) {
+            gearman_task_free((*tasks)[--i]);
+        }
+        PyMem_Free(*tasks);
+        *tasks = NULL;
+    }
+    if (!g_client) {
+        // Likewise for the contexts deferred so far
+        pygear_task_context* context = (old_tail ? old_tail->next : self->pending);
+        if (old_tail) {
+            old_tail->next = NULL;
+        } else {
+            self->pending = NULL;
+        }
+        self->pending_tail = old_tail;
+        while (context) {
+            pygear_task_context* next = context->next;
+            _pygear_task_context_free(NULL, context);
+            context = next;
+        }
+    }
+    Py_DECREF(workload_seq);
+    Py_XDECREF(unique_seq);
+    return -1;
+}
+
+
 #define CLIENT_ADD_TASK(TASKTYPE) \
 static PyObject* pygear_client_add_task##TASKTYPE(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) { \
     /* Parsing input arguments */ \
@@ -160,55 +481,16 @@ static PyObject* pygear_client_add_task##TASKTYPE(pygear_ClientObject* self, PyO
         &function_name, &workload, &unique)) { \
         return NULL; \
     } \
-    /* Convert python input to string */ \
-    PyObject* dumpstr = PyString_FromString("dumps"); \
-    PyObject* pickled_input = PyObject_CallMethodObjArgs( \
-        self->serializer, \
-        dumpstr, \
-        workload, \
-        NULL \
-    ); \
-    Py_XDECREF(dumpstr); \
-    if (!pickled_input) { \
-        return NULL; \
-    } \
-    char* workload_string; \
-    Py_ssize_t workload_size; \
-    PyString_AsStringAndSize(pickled_input, &workload_string, &workload_size); \
-    /* Py_XDECREF(pickled_input); */ \
-    /* dealloc pickled_input will cause error because tasks are not sented until client_run_tasks() is called */ \
-    /* Call gearman_add_task function */ \
-    gearman_return_t ret; \
-    gearman_task_st* new_task = gearman_client_add_task##TASKTYPE( \
-        self->g_Client, \
-        NULL, /* task */ \
-        self, /* context */ \
-        function_name, \
-        unique, \
-        workload_string, \
-        workload_size, \
-        &ret \
-    ); \
-    if (_pygear_check_and_raise_exn(ret)) { \
-        return NULL; \
-    } \
-    /* Creating new python task */ \
-    PyObject *argList = Py_BuildValue("(O, O)", Py_None, Py_None); \
-    pygear_TaskObject* python_task = (pygear_TaskObject*) PyObject_CallObject((PyObject *) &pygear_TaskType, argList); \
-    PyObject* method_result = PyObject_CallMethod((PyObject*) python_task, "set_serializer", "O", self->serializer); \
-    if (!method_result) { \
-        Py_XDECREF(argList); \
-        Py_XDECREF(python_task); \
+    pygear_compression_t compression; \
+    _pygear_compression_for(self->compression_map, &self->compression, function_name, &compression); \
+    pygear_task_context* context = _pygear_task_context_prepare(self, \
+        gearman_client_add_task##TASKTYPE, function_name, unique, workload, &compression); \
+    if (!context) { \
         return NULL; \
     } \
-    Py_XDECREF(method_result); \
-    Py_XDECREF(argList); \
-    /* Return task */ \
-    python_task->g_Task = new_task; \
-    PyObject* result = Py_BuildValue("O", python_task); \
-    python_task->g_Task = NULL; \
-    Py_XDECREF(python_task); \
-    return result; \
+    /* Held until run_tasks, which submits it to libgearman */ \
+    _pygear_client_defer(self, context); \
+    return (PyObject*) _pygear_task_new(self->serializer, self->codec, self->typed_arrays, NULL); \
 }
 
 
@@ -220,27 +502,103 @@ CLIENT_ADD_TASK(_low)
 CLIENT_ADD_TASK(_low_background)
 
 
+static PyObject* pygear_client_add_tasks(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) {
+    char* function_name;
+    PyObject* workloads;
+    PyObject* uniques = Py_None;
+    int priority = GEARMAN_JOB_PRIORITY_NORMAL;
+    PyObject* background = Py_False;
+    static char* kwlist[] = {"function", "workloads", "uniques", "priority", "background", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|OiO", kwlist,
+        &function_name, &workloads, &uniques, &priority, &background)) {
+        return NULL;
+    }
+    int is_background = PyObject_IsTrue(background);
+    if (is_background == -1) {
+        return NULL;
+    }
+    pygear_add_task_fn add_task = _pygear_add_task_fn(priority, is_background);
+    if (!add_task) {
+        return NULL;
+    }
+    Py_ssize_t num_tasks = _pygear_client_queue_tasks(self, NULL, add_task,
+        function_name, workloads, uniques, NULL);
+    if (num_tasks == -1) {
+        return NULL;
+    }
+    return PyInt_FromSsize_t(num_tasks);
+}
+
+static PyObject* pygear_client_submit(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) {
+    char* function_name;
+    PyObject* workload;
+    char* unique = NULL;
+    int priority = GEARMAN_JOB_PRIORITY_NORMAL;
+    static char* kwlist[] = {"function", "workload", "unique", "priority", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|zi", kwlist,
+        &function_name, &workload, &unique, &priority)) {
+        return NULL;
+    }
+    pygear_add_task_fn add_task = _pygear_add_task_fn(priority, 0);
+    if (!add_task) {
+        return NULL;
+    }
+    pygear_compression_t compression;
+    _pygear_compression_for(self->compression_map, &self->compression, function_name, &compression);
+    pygear_task_context* context = _pygear_task_context_prepare(self, add_task,
+        function_name, unique, workload, &compression);
+    if (!context) {
+        return NULL;
+    }
+    PyObject* future = _pygear_future_new((PyObject*) self);
+    if (!future) {
+        _pygear_task_context_free(NULL, context);
+        return NULL;
+    }
+    // The task completes the future through its context, see CALLBACK_WRAPPER
+    Py_INCREF(future);
+    context->future = future;
+    _pygear_client_defer(self, context);
+    return future;
+}
+
+static PyObject* pygear_client_as_completed(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) {
+    PyObject* futures;
+    PyObject* timeout = Py_None;
+    static char* kwlist[] = {"futures", "timeout", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &futures, &timeout)) {
+        return NULL;
+    }
+    return _pygear_future_iterator_new((PyObject*) self, futures, timeout);
+}
+
+
 static PyObject* pygear_client_add_task_status(pygear_ClientObject* self, PyObject* args) {
     char* job_handle;
     if (!PyArg_ParseTuple(args, "s", &job_handle)) {
         return NULL;
     }
+    pygear_task_context* context = _pygear_task_context_new(self);
+    if (!context) {
+        return NULL;
+    }
     gearman_return_t gearman_return;
     gearman_task_st* new_task = gearman_client_add_task_status(
         self->g_Client,
         NULL,
-        (void*) self,
+        NULL,
         job_handle,
         &gearman_return
     );
     if (_pygear_check_and_raise_exn(gearman_return)) {
+        _pygear_task_context_free(NULL, context);
         return NULL;
     }
-    pygear_TaskObject* python_task = (pygear_TaskObject*) _PyObject_New(&pygear_TaskType);
+    gearman_task_set_context(new_task, context);
+    pygear_TaskObject* python_task = _pygear_task_new(self->serializer, self->codec, self->typed_arrays, new_task);
     if (!python_task){
         return NULL;
     }
-    python_task->g_Task = new_task;
     PyObject* ret = Py_BuildValue("O", python_task);
     Py_XDECREF(python_task);
     return ret;
@@ -249,6 +607,7 @@ static PyObject* pygear_client_add_task_status(pygear_ClientObject* self, PyObje
 
 static PyObject* pygear_client_clear_fn(pygear_ClientObject* self) {
     gearman_client_clear_fn(self->g_Client);
+    _pygear_client_set_tracking_fn(self->g_Client);
     Py_XDECREF(self->cb_workload); self->cb_workload = NULL;
     Py_XDECREF(self->cb_created); self->cb_created = NULL;
     Py_XDECREF(self->cb_data); self->cb_data = NULL;
@@ -267,63 +626,104 @@ static PyObject* pygear_client_clone(pygear_ClientObject* self) {
     PyObject* ret = NULL;
     argList = Py_BuildValue("(O, O)", Py_None, Py_None);
     python_client = (pygear_ClientObject*) PyObject_CallObject((PyObject *) &pygear_ClientType, argList);
+    if (!python_client) {
+        goto catch;
+    }
+    gearman_client_free(python_client->g_Client);
     python_client->g_Client = gearman_client_clone(NULL, self->g_Client);
+    if (!python_client->g_Client) {
+        PyErr_SetString(PyGearExn_ERROR, "Failed to clone internal gearman client structure");
+        goto catch;
+    }
+    gearman_client_set_task_context_free_fn(python_client->g_Client, _pygear_task_context_free);
+    // The waiter was set up for the structure just freed
+    _pygear_waiter_init(&python_client->waiter, _pygear_client_wait, python_client->g_Client);
     ret = Py_BuildValue("O", python_client);
+catch:
     Py_XDECREF(argList);
     Py_XDECREF(python_client);
     return ret;
 }
 
 
+/* private method; run a quiet task to completion for do, do_high and do_low,
+ * waiting through _pygear_waiter_wait so that signals and the wait hook get a
+ * turn. Takes workload over. Returns the decoded result, or NULL with an
+ * exception set. */
+static PyObject* _pygear_client_do(pygear_ClientObject* self, pygear_add_task_fn add_task,
+    const char* function_name, const char* unique, Py_buffer* workload) {
+    pygear_task_context* context = _pygear_task_context_new(self);
+    if (!context) {
+        PyBuffer_Release(workload);
+        return NULL;
+    }
+    context->workload = *workload;
+    context->has_workload = 1;
+    context->add_task = add_task;
+    context->quiet = 1;
+    context->function_name = _pygear_strdup(function_name);
+    context->unique = _pygear_strdup(unique);
+    if (!context->function_name || (unique && !context->unique)) {
+        _pygear_task_context_free(NULL, context);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    gearman_task_st* task = _pygear_client_submit(self->g_Client, context);
+    if (!task) {
+        return NULL;
+    }
+    PyObject* result = NULL;
+    if (_pygear_client_run_until_done(self, &task, 1) == -1 ||
+        _pygear_check_and_raise_exn(gearman_task_return(task))) {
+        goto done;
+    }
+    if (PYGEAR_IS_RAW(self->serializer)) {
+        /* Hand the libgearman buffer over without copying it */
+        result = _pygear_task_take_result(task);
+        goto done;
+    }
+    const char* task_result = gearman_task_data(task);
+    if (!task_result) {
+        Py_INCREF(Py_None);
+        result = Py_None;
+        goto done;
+    }
+    result = _pygear_deserialize(self->serializer, self->codec, self->typed_arrays,
+        task_result, gearman_task_data_size(task));
+
+done:
+    // Also releases the workload through the task context
+    gearman_task_free(task);
+    return result;
+}
+
 #define CLIENT_DO(DOTYPE) \
 static PyObject* pygear_client_do##DOTYPE(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) { \
     /* Parsing input arguments */ \
     char* function_name; \
     PyObject* workload; \
-    Py_ssize_t workload_size; \
     char* unique = NULL;  /* optional */ \
-    static char* kwlist[] = {"function", "workload", "unique", NULL}; \
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|s", kwlist, \
-        &function_name, &workload, &unique)) { \
+    PyObject* schema = NULL; /* optional */ \
+    static char* kwlist[] = {"function", "workload", "unique", "schema", NULL}; \
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|zO", kwlist, \
+        &function_name, &workload, &unique, &schema)) { \
         return NULL; \
     } \
-    /* Convert python input to string */ \
-    PyObject* dumpstr = PyString_FromString("dumps"); \
-    PyObject* pickled_input = PyObject_CallMethodObjArgs( \
-        self->serializer, \
-        dumpstr, \
-        workload, \
-        NULL \
-    ); \
-    Py_XDECREF(dumpstr); \
-    char* workload_string; \
-    PyString_AsStringAndSize(pickled_input, &workload_string, &workload_size); \
-    /* Call gearman_do function */ \
-    size_t result_size; \
-    gearman_return_t ret; \
-    void* work_result = gearman_client_do##DOTYPE( \
-        self->g_Client, \
-        function_name, \
-        unique, \
-        workload_string, \
-        workload_size, \
-        &result_size, \
-        &ret); /* work_result must be freed later to avoid memory leak */ \
-    Py_XDECREF(pickled_input); /* safely dealloc workload */ \
-    if (_pygear_check_and_raise_exn(ret)) { \
-        free(work_result); \
+    /* Export the workload bytes; the task holds on to them until it is freed */ \
+    Py_buffer pickled_input; \
+    if (_pygear_serialize_workload(schema, self->serializer, self->codec, self->typed_arrays, workload, &pickled_input) == -1) { \
         return NULL; \
     } \
-    /* Convert result to python format */ \
-    PyObject* py_result = Py_BuildValue("s#", work_result, result_size); \
-    free(work_result); \
-    if (py_result == Py_None) { \
-        Py_XDECREF(py_result); \
-        Py_RETURN_NONE; \
+    pygear_compression_t compression; \
+    _pygear_compression_for(self->compression_map, &self->compression, function_name, &compression); \
+    if (_pygear_compress(self->serializer, &compression, &pickled_input) == -1) { \
+        PyBuffer_Release(&pickled_input); \
+        return NULL; \
     } \
-    PyObject* ret_dict = PyObject_CallMethod(self->serializer, "loads", "O", py_result); \
-    Py_XDECREF(py_result); \
-    return ret_dict; \
+    /* A task rather than gearman_client_do, which never hands control back */ \
+    /* before the job is done */ \
+    return _pygear_client_do(self, gearman_client_add_task##DOTYPE, function_name, \
+        unique, &pickled_input); \
 }
 
 CLIENT_DO()
@@ -335,35 +735,38 @@ static PyObject* pygear_client_do##DOTYPE##_background(pygear_ClientObject* self
     /* Parsing input arguments */ \
     char* function_name; \
     PyObject* workload; \
-    Py_ssize_t workload_size; \
     char* unique = NULL; /* optional */ \
-    static char* kwlist[] = {"function", "workload", "unique", NULL}; \
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|s", kwlist, \
-        &function_name, &workload, &unique)) { \
+    PyObject* schema = NULL; /* optional */ \
+    static char* kwlist[] = {"function", "workload", "unique", "schema", NULL}; \
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|zO", kwlist, \
+        &function_name, &workload, &unique, &schema)) { \
         return NULL; \
     } \
-    /* Convert python input to string */ \
-    PyObject* dumpstr = PyString_FromString("dumps"); \
-    PyObject* pickled_input = PyObject_CallMethodObjArgs( \
-        self->serializer, \
-        dumpstr, \
-        workload, \
-        NULL \
-    ); \
-    Py_XDECREF(dumpstr); \
-    char* workload_string; \
-    PyString_AsStringAndSize(pickled_input, &workload_string, &workload_size); \
-    /* Call libgearman function */ \
+    /* Export the workload bytes; held only until the call returns */ \
+    Py_buffer pickled_input; \
+    if (_pygear_serialize_workload(schema, self->serializer, self->codec, self->typed_arrays, workload, &pickled_input) == -1) { \
+        return NULL; \
+    } \
+    pygear_compression_t compression; \
+    _pygear_compression_for(self->compression_map, &self->compression, function_name, &compression); \
+    if (_pygear_compress(self->serializer, &compression, &pickled_input) == -1) { \
+        PyBuffer_Release(&pickled_input); \
+        return NULL; \
+    } \
+    /* Call libgearman function without holding the GIL */ \
     char* job_handle = malloc(sizeof(char) * GEARMAN_JOB_HANDLE_SIZE); \
-    gearman_return_t work_result = gearman_client_do##DOTYPE##_background( \
+    gearman_return_t work_result; \
+    Py_BEGIN_ALLOW_THREADS \
+    work_result = gearman_client_do##DOTYPE##_background( \
         self->g_Client, \
         function_name, \
         unique, \
-        workload_string, \
-        workload_size, \
+        pickled_input.buf, \
+        pickled_input.len, \
         job_handle \
     ); \
-    Py_XDECREF(pickled_input); /* safely dealloc workload */ \
+    Py_END_ALLOW_THREADS \
+    PyBuffer_Release(&pickled_input); \
     if (_pygear_check_and_raise_exn(work_result)) { \
         free(job_handle); \
         return NULL; \
@@ -380,6 +783,59 @@ CLIENT_DO_BACKGROUND()
 CLIENT_DO_BACKGROUND(_high)
 CLIENT_DO_BACKGROUND(_low)
 
+static PyObject* pygear_client_do_background_many(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) {
+    char* function_name;
+    PyObject* workloads;
+    PyObject* uniques = Py_None;
+    int priority = GEARMAN_JOB_PRIORITY_NORMAL;
+    static char* kwlist[] = {"function", "workloads", "uniques", "priority", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|Oi", kwlist,
+        &function_name, &workloads, &uniques, &priority)) {
+        return NULL;
+    }
+    pygear_add_task_fn add_task = _pygear_add_task_fn(priority, 1);
+    if (!add_task) {
+        return NULL;
+    }
+    // Quiet tasks on the client's own connection, so that none of its
+    // callbacks fire for them and tasks queued with add_task* stay queued
+    PyObject* handles = NULL;
+    gearman_task_st** tasks = NULL;
+    Py_ssize_t i, num_tasks = _pygear_client_queue_tasks(self, self->g_Client, add_task,
+        function_name, workloads, uniques, &tasks);
+    if (num_tasks == -1) {
+        return NULL;
+    }
+    // All SUBMIT_JOB_BG packets go out before the first JOB_CREATED is read
+    if (_pygear_client_run_until_done(self, tasks, num_tasks) == -1) {
+        goto done;
+    }
+    handles = PyList_New(num_tasks);
+    if (!handles) {
+        goto done;
+    }
+    for (i = 0; i < num_tasks; ++i) {
+        if (_pygear_check_and_raise_exn(gearman_task_return(tasks[i]))) {
+            Py_CLEAR(handles);
+            goto done;
+        }
+        PyObject* handle = PyString_FromString(gearman_task_job_handle(tasks[i]));
+        if (!handle) {
+            Py_CLEAR(handles);
+            goto done;
+        }
+        PyList_SET_ITEM(handles, i, handle);
+    }
+
+done:
+    // Also releases their workloads through the task contexts
+    for (i = 0; i < num_tasks; ++i) {
+        gearman_task_free(tasks[i]);
+    }
+    PyMem_Free(tasks);
+    return handles;
+}
+
 static PyObject* pygear_client_do_job_handle(pygear_ClientObject* self) {
     return Py_BuildValue("s", gearman_client_do_job_handle(self->g_Client));
 }
@@ -399,7 +855,10 @@ static PyObject* pygear_client_echo(pygear_ClientObject* self, PyObject* args) {
     if (!PyArg_ParseTuple(args, "s#", &workload, &workload_len)) {
         return NULL;
     }
-    gearman_return_t result = gearman_client_echo(self->g_Client, workload, workload_len);
+    gearman_return_t result;
+    Py_BEGIN_ALLOW_THREADS
+    result = gearman_client_echo(self->g_Client, workload, workload_len);
+    Py_END_ALLOW_THREADS
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
@@ -430,24 +889,42 @@ static PyObject* pygear_client_execute(pygear_ClientObject* self, PyObject* args
     PyObject* ret = NULL;
     // Mandatory arguments
     char* function_name;
-    char* workload;
-    int workload_size;
+    PyObject* workload;
     // Optional arguments
     char* unique = NULL;
     char* name = NULL;
     static char* kwlist[] = {"function", "workload", "unique", "name", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss#|ss", kwlist,
-        &function_name, &workload, &workload_size, &unique, &name)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|ss", kwlist,
+        &function_name, &workload, &unique, &name)) {
+        return NULL;
+    }
+    // Any buffer works as the workload, it is only needed until execution returns.
+    // Unicode never goes through the serializer here, so it is encoded with
+    // the default encoding, as "s#" used to.
+    PyObject* encoded = NULL;
+    if (PyUnicode_Check(workload)) {
+        encoded = PyUnicode_AsEncodedString(workload, NULL, NULL);
+        if (!encoded) {
+            return NULL;
+        }
+        workload = encoded;
+    }
+    Py_buffer workload_view;
+    int got_buffer = _pygear_get_buffer(workload, &workload_view);
+    Py_XDECREF(encoded);
+    if (got_buffer == -1) {
         return NULL;
     }
     // Generate the arguments for the function
     gearman_argument_t arguments = gearman_argument_make(
         name, (name ? strlen(name) : 0),
-        workload, workload_size
+        workload_view.buf, workload_view.len
     );
     // Execute the function
     // TODO: do we need to free new_task later?
-    gearman_task_st* new_task = gearman_execute(
+    gearman_task_st* new_task;
+    Py_BEGIN_ALLOW_THREADS
+    new_task = gearman_execute(
         self->g_Client,
         function_name, strlen(function_name),
         unique, (unique? strlen(unique) : 0),
@@ -455,18 +932,17 @@ static PyObject* pygear_client_execute(pygear_ClientObject* self, PyObject* args
         &arguments,
         NULL // context
     );
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&workload_view);
     if (new_task == NULL) {
         if (_pygear_check_and_raise_exn(gearman_client_errno(self->g_Client))) {
             return NULL;
         }
     }
     // Convert task to python format
-    PyObject* argList = Py_BuildValue("(O, O)", Py_None, Py_None);
-    pygear_TaskObject* python_task = (pygear_TaskObject*) PyObject_CallObject((PyObject *) &pygear_TaskType, argList);
-    python_task->g_Task = new_task;
-    PyObject* method_result = PyObject_CallMethod((PyObject*) python_task, "set_serializer", "O", self->serializer);
-    if (!method_result) {
-        goto catch;
+    pygear_TaskObject* python_task = _pygear_task_new(self->serializer, self->codec, self->typed_arrays, new_task);
+    if (!python_task) {
+        return NULL;
     }
     // Make sure the task was run successfully
     if (_pygear_check_and_raise_exn(gearman_task_return(new_task))) {
@@ -478,9 +954,7 @@ static PyObject* pygear_client_execute(pygear_ClientObject* self, PyObject* args
     const char* result_data = gearman_result_value(result);
     ret = Py_BuildValue("s#", result_data, result_size);
 catch:
-    Py_XDECREF(argList);
     Py_XDECREF(python_task);
-    Py_XDECREF(method_result);
     return ret;
 }
 
@@ -514,6 +988,16 @@ static PyObject* pygear_client_get_options(pygear_ClientObject* self) {
 }
 
 
+static PyObject* _pygear_status_dict(bool is_known, bool is_running, unsigned numerator, unsigned denominator) {
+    return Py_BuildValue(
+        "{s:O, s:O, s:I, s:I}",
+        "is_known", (is_known ? Py_True : Py_False),
+        "is_running", (is_running ? Py_True : Py_False),
+        "numerator", numerator,
+        "denominator", denominator
+    );
+}
+
 static PyObject* pygear_client_job_status(pygear_ClientObject* self, PyObject* args) {
     gearman_job_handle_t job_handle;
     bool is_known, is_running;
@@ -521,23 +1005,96 @@ static PyObject* pygear_client_job_status(pygear_ClientObject* self, PyObject* a
     if (!PyArg_ParseTuple(args, "s", &job_handle)) {
         return NULL;
     }
-    gearman_return_t result = gearman_client_job_status(
+    gearman_return_t result;
+    Py_BEGIN_ALLOW_THREADS
+    result = gearman_client_job_status(
         self->g_Client,
         job_handle,
         &is_known, &is_running,
         &numerator, &denominator
     );
+    Py_END_ALLOW_THREADS
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
-    PyObject* status_dict = Py_BuildValue(
-        "{s:O, s:O, s:I, s:I}",
-        "is_known", (is_known ? Py_True : Py_False),
-        "is_running", (is_running ? Py_True : Py_False),
-        "numerator", numerator,
-        "denominator", denominator
-    );
-    return status_dict;
+    return _pygear_status_dict(is_known, is_running, numerator, denominator);
+}
+
+
+/*
+ * Queue a status request per key (job handles, or unique ids if by_unique)
+ * and run them together, so that all requests are written before the first
+ * answer is read. The tasks have no context, so no callback sees them.
+ */
+static PyObject* _pygear_client_status_many(pygear_ClientObject* self, PyObject* keys, int by_unique) {
+    PyObject* key_seq = PySequence_Fast(keys, "expected an iterable of strings");
+    if (!key_seq) {
+        return NULL;
+    }
+    Py_ssize_t i, num_tasks = 0, num_keys = PySequence_Fast_GET_SIZE(key_seq);
+    PyObject* statuses = NULL;
+    gearman_task_st** tasks = PyMem_New(gearman_task_st*, num_keys ? num_keys : 1);
+    if (!tasks) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0; i < num_keys; ++i) {
+        char* key = PyString_AsString(PySequence_Fast_GET_ITEM(key_seq, i));
+        if (!key) {
+            goto done;
+        }
+        gearman_return_t ret;
+        if (by_unique) {
+            tasks[i] = gearman_client_add_task_status_by_unique(self->g_Client, NULL, key, &ret);
+        } else {
+            tasks[i] = gearman_client_add_task_status(self->g_Client, NULL, NULL, key, &ret);
+        }
+        if (_pygear_check_and_raise_exn(ret)) {
+            goto done;
+        }
+        ++num_tasks;
+    }
+    if (_pygear_client_run_until_done(self, tasks, num_tasks) == -1) {
+        goto done;
+    }
+    statuses = PyDict_New();
+    if (!statuses) {
+        goto done;
+    }
+    for (i = 0; i < num_keys; ++i) {
+        if (_pygear_check_and_raise_exn(gearman_task_return(tasks[i]))) {
+            Py_CLEAR(statuses);
+            goto done;
+        }
+        PyObject* status_dict = _pygear_status_dict(
+            gearman_task_is_known(tasks[i]),
+            gearman_task_is_running(tasks[i]),
+            gearman_task_numerator(tasks[i]),
+            gearman_task_denominator(tasks[i])
+        );
+        if (!status_dict || PyDict_SetItem(statuses, PySequence_Fast_GET_ITEM(key_seq, i), status_dict) == -1) {
+            Py_XDECREF(status_dict);
+            Py_CLEAR(statuses);
+            goto done;
+        }
+        Py_DECREF(status_dict);
+    }
+
+done:
+    for (i = 0; i < num_tasks; ++i) {
+        gearman_task_free(tasks[i]);
+    }
+    PyMem_Free(tasks);
+    Py_DECREF(key_seq);
+    return statuses;
+}
+
+static PyObject* pygear_client_job_status_many(pygear_ClientObject* self, PyObject* args) {
+    PyObject* job_handles;
+    if (!PyArg_ParseTuple(args, "O", &job_handles)) {
+        return NULL;
+    }
+    return _pygear_client_status_many(self, job_handles, 0);
 }
 
 
@@ -547,48 +1104,230 @@ static PyObject* pygear_client_remove_servers(pygear_ClientObject* self) {
 }
 
 
-static PyObject* pygear_client_run_tasks(pygear_ClientObject* self) {
-    gearman_return_t result = gearman_client_run_tasks(self->g_Client);
-    if (_pygear_check_and_raise_exn(result)) {
+int _pygear_client_run_until_done(pygear_ClientObject* self, gearman_task_st** tasks, Py_ssize_t num_tasks) {
+    _pygear_waiter_park(&self->waiter);
+    // Non-blocking, so that waits happen in _pygear_waiter_wait, and without
+    // FREE_TASKS, so that the tasks can still be read once they are done
+    int was_non_blocking = gearman_client_has_option(self->g_Client, GEARMAN_CLIENT_NON_BLOCKING);
+    int was_free_tasks = gearman_client_has_option(self->g_Client, GEARMAN_CLIENT_FREE_TASKS);
+    gearman_client_add_options(self->g_Client, GEARMAN_CLIENT_NON_BLOCKING);
+    gearman_client_remove_options(self->g_Client, GEARMAN_CLIENT_FREE_TASKS);
+    int timeout = gearman_client_timeout(self->g_Client);
+    int status = 0;
+    Py_ssize_t next_active = 0;
+    while (1) {
+        while (next_active < num_tasks && !gearman_task_is_active(tasks[next_active])) {
+            ++next_active;
+        }
+        if (next_active == num_tasks) {
+            break;
+        }
+        gearman_return_t result;
+        Py_BEGIN_ALLOW_THREADS
+        result = gearman_client_run_tasks(self->g_Client);
+        Py_END_ALLOW_THREADS
+        if (result == GEARMAN_SUCCESS) {
+            // Every task on the client is done
+            break;
+        }
+        if (result == GEARMAN_PAUSE) {
+            continue;
+        }
+        if (result != GEARMAN_IO_WAIT) {
+            _pygear_check_and_raise_exn(result);
+            status = -1;
+            break;
+        }
+        // Still waiting, but possibly only on tasks that are not ours
+        if (!gearman_task_is_active(tasks[next_active])) {
+            continue;
+        }
+        int ready = _pygear_waiter_wait(&self->waiter, timeout);
+        if (ready == -1) {
+            status = -1;
+            break;
+        }
+        if (!ready && timeout >= 0) {
+            _pygear_check_and_raise_exn(GEARMAN_TIMEOUT);
+            status = -1;
+            break;
+        }
+    }
+    if (!was_non_blocking) {
+        gearman_client_remove_options(self->g_Client, GEARMAN_CLIENT_NON_BLOCKING);
+    }
+    if (was_free_tasks) {
+        gearman_client_add_options(self->g_Client, GEARMAN_CLIENT_FREE_TASKS);
+    }
+    return status;
+}
+
+int _pygear_client_step(pygear_ClientObject* self, Py_ssize_t max_in_flight, int timeout) {
+    _pygear_waiter_park(&self->waiter);
+    // Run non-blocking so that control comes back here whenever libgearman
+    // would wait, which is when finished tasks make room in the window
+    int was_non_blocking = gearman_client_has_option(self->g_Client, GEARMAN_CLIENT_NON_BLOCKING);
+    gearman_client_add_options(self->g_Client, GEARMAN_CLIENT_NON_BLOCKING);
+    // Without FREE_TASKS, since the submitted list still links the contexts of
+    // finished tasks until they are swept
+    int was_free_tasks = gearman_client_has_option(self->g_Client, GEARMAN_CLIENT_FREE_TASKS);
+    gearman_client_remove_options(self->g_Client, GEARMAN_CLIENT_FREE_TASKS);
+    int status = 0;
+    gearman_return_t result;
+    Py_ssize_t in_flight = _pygear_client_sweep_tasks(self, 0);
+    in_flight = _pygear_client_submit_pending(self, in_flight, max_in_flight);
+    if (in_flight == -1) {
+        status = -1;
+        goto done;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    result = gearman_client_run_tasks(self->g_Client);
+    Py_END_ALLOW_THREADS
+    in_flight = _pygear_client_sweep_tasks(self, result == GEARMAN_SUCCESS);
+    if (result == GEARMAN_SUCCESS) {
+        status = (self->pending ? 0 : 1);
+        goto done;
+    }
+    if (result == GEARMAN_IO_WAIT && !(self->pending && (max_in_flight < 0 || in_flight < max_in_flight))) {
+        int wait_timeout = (timeout >= 0 ? timeout : gearman_client_timeout(self->g_Client));
+        int ready = _pygear_waiter_wait(&self->waiter, wait_timeout);
+        if (ready == -1) {
+            status = -1;
+            goto done;
+        }
+        result = (ready || wait_timeout < 0 ? GEARMAN_SUCCESS : GEARMAN_TIMEOUT);
+        // The caller keeps track of its own deadline
+        if (result == GEARMAN_TIMEOUT && timeout >= 0) {
+            result = GEARMAN_SUCCESS;
+        }
+    }
+    if (result != GEARMAN_IO_WAIT && _pygear_check_and_raise_exn(result)) {
+        status = -1;
+    }
+
+done:
+    if (!was_non_blocking) {
+        gearman_client_remove_options(self->g_Client, GEARMAN_CLIENT_NON_BLOCKING);
+    }
+    if (was_free_tasks) {
+        gearman_client_add_options(self->g_Client, GEARMAN_CLIENT_FREE_TASKS);
+    }
+    return status;
+}
+
+static PyObject* pygear_client_run_tasks(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) {
+    PyObject* py_max_in_flight = Py_None;
+    static char* kwlist[] = {"max_in_flight", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &py_max_in_flight)) {
+        return NULL;
+    }
+    Py_ssize_t max_in_flight = -1;
+    if (py_max_in_flight != Py_None) {
+        max_in_flight = PyNumber_AsSsize_t(py_max_in_flight, PyExc_OverflowError);
+        if (max_in_flight == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (max_in_flight < 1) {
+            PyErr_SetString(PyExc_ValueError, "max_in_flight must be a positive integer or None");
+            return NULL;
+        }
+    }
+    // Step instead of a single blocking gearman_client_run_tasks, so that
+    // signal handlers and the wait hook run whenever libgearman would block
+    int status = 0;
+    while (status == 0) {
+        status = _pygear_client_step(self, max_in_flight, -1);
+    }
+    if (status == -1) {
         return NULL;
     }
     Py_RETURN_NONE;
 }
 
 
-#define CALLBACK_WRAPPER(CB) gearman_return_t pygear_client_wrap_callback_##CB(gearman_task_st* gear_task) { \
-    pygear_ClientObject* client = (pygear_ClientObject*) gearman_task_context(gear_task); \
-    if (!client->cb_##CB) { \
+static PyObject* pygear_client_step(pygear_ClientObject* self) {
+    int status = _pygear_client_step(self, -1, 0);
+    if (status == -1) {
+        return NULL;
+    }
+    if (status == 0) {
+        _pygear_waiter_arm(&self->waiter, gearman_client_timeout(self->g_Client));
+    }
+    return PyBool_FromLong(status);
+}
+
+static PyObject* pygear_client_fileno(pygear_ClientObject* self) {
+    int fd = _pygear_waiter_fileno(&self->waiter);
+    if (fd == -1) {
+        return NULL;
+    }
+    return PyInt_FromLong(fd);
+}
+
+
+/* private method, called by CALLBACK_WRAPPER with the GIL held */
+static void _pygear_task_context_event(pygear_task_context* context, int event) {
+    if (event == PYGEAR_TASK_EVENT_NONE) {
+        return;
+    }
+    // Once the job server has created the job the workload is never resent
+    _pygear_task_context_release_workload(context);
+    if (event >= PYGEAR_TASK_EVENT_COMPLETE || context->background) {
+        context->finished = 1;
+    }
+}
+
+/* private method, called by CALLBACK_WRAPPER with the GIL held */
+static gearman_return_t _pygear_client_callback(pygear_ClientObject* client, PyObject* callback,
+    gearman_task_st* gear_task, PyObject* raw_result) {
+    pygear_TaskObject* python_task = _pygear_task_new(client->serializer, client->codec, client->typed_arrays, gear_task);
+    if (!python_task) {
+        PyErr_Print();
+        return GEARMAN_ERROR;
+    }
+    // Task.result hands back the cached RAW result instead of taking the data again
+    Py_XINCREF(raw_result);
+    python_task->result = raw_result;
+    PyObject* callback_return = PyObject_CallFunction(callback, "O", python_task);
+    if (!callback_return) {
+        if (PyErr_Occurred()) {
+            PyErr_Print();
+        }
+    }
+    /* Release the thread */
+    python_task->g_Task = NULL;
+    Py_XDECREF(python_task);
+    Py_XDECREF(callback_return);
+    return GEARMAN_SUCCESS;
+}
+
+#define CALLBACK_WRAPPER(CB, EVENT) gearman_return_t pygear_client_wrap_callback_##CB(gearman_task_st* gear_task) { \
+    pygear_task_context* context = (pygear_task_context*) gearman_task_context(gear_task); \
+    if (!context) { \
         return GEARMAN_SUCCESS; \
     } \
-    /* Need to lock the GIL to avoid undefined behaviour */ \
+    pygear_ClientObject* client = context->client; \
+    /* Need to lock the GIL to avoid undefined behaviour; libgearman calls */ \
+    /* back into here while the calling thread has released it */ \
     PyGILState_STATE gstate = PyGILState_Ensure(); \
-    PyObject *argList = Py_BuildValue("(O, O)", Py_None, Py_None); \
-    pygear_TaskObject* python_task = (pygear_TaskObject*) PyObject_CallObject((PyObject *) &pygear_TaskType, argList); \
-    PyObject* method_result = PyObject_CallMethod((PyObject*) python_task, "set_serializer", "O", client->serializer); \
-    if (!method_result) { \
-        PyErr_Print(); \
-        Py_XDECREF(argList); \
-        Py_XDECREF(python_task); \
-        Py_XDECREF(method_result); \
-        PyGILState_Release(gstate); \
-        return GEARMAN_ERROR; \
-    } \
-    python_task->g_Task = gear_task; \
-    PyObject* callback_return = PyObject_CallFunction(client->cb_##CB, "O", python_task); \
-    if (!callback_return) { \
-        if (PyErr_Occurred()) { \
-            PyErr_Print(); \
+    _pygear_task_context_event(context, EVENT); \
+    gearman_return_t ret = GEARMAN_SUCCESS; \
+    /* A RAW result can only be taken once, so the future and the callback's */ \
+    /* Task share it */ \
+    PyObject* raw_result = NULL; \
+    if (context->future && EVENT >= PYGEAR_TASK_EVENT_COMPLETE) { \
+        if (PYGEAR_IS_RAW(client->serializer)) { \
+            raw_result = _pygear_task_take_result(gear_task); \
         } \
+        _pygear_future_task_event(context->future, client->serializer, client->codec, \
+            client->typed_arrays, gear_task, raw_result, EVENT); \
+    } \
+    if (client->cb_##CB && !context->quiet) { \
+        ret = _pygear_client_callback(client, client->cb_##CB, gear_task, raw_result); \
     } \
-    /* Release the thread */ \
-    Py_XDECREF(argList); \
-    python_task->g_Task = NULL; \
-    Py_XDECREF(python_task); \
-    Py_XDECREF(method_result); \
-    Py_XDECREF(callback_return); \
+    Py_XDECREF(raw_result); \
     PyGILState_Release(gstate); \
-    return GEARMAN_SUCCESS; \
+    return ret; \
 }
 
 #define CALLBACK_SETTER(CB) static PyObject* pygear_client_set_##CB##_fn(pygear_ClientObject* self, PyObject* args) { \
@@ -605,16 +1344,25 @@ static PyObject* pygear_client_run_tasks(pygear_ClientObject* self) {
     Py_RETURN_NONE; \
 }
 
-#define CALLBACK_HANDLE(CB) CALLBACK_WRAPPER(CB) CALLBACK_SETTER(CB)
-
-CALLBACK_HANDLE(created)
-CALLBACK_HANDLE(complete)
-CALLBACK_HANDLE(data)
-CALLBACK_HANDLE(exception)
-CALLBACK_HANDLE(fail)
-CALLBACK_HANDLE(status)
-CALLBACK_HANDLE(warning)
-CALLBACK_HANDLE(workload)
+#define CALLBACK_HANDLE(CB, EVENT) CALLBACK_WRAPPER(CB, EVENT) CALLBACK_SETTER(CB)
+
+CALLBACK_HANDLE(created,    PYGEAR_TASK_EVENT_CREATED)
+CALLBACK_HANDLE(complete,   PYGEAR_TASK_EVENT_COMPLETE)
+CALLBACK_HANDLE(data,       PYGEAR_TASK_EVENT_NONE)
+CALLBACK_HANDLE(exception,  PYGEAR_TASK_EVENT_EXCEPTION)
+CALLBACK_HANDLE(fail,       PYGEAR_TASK_EVENT_FAIL)
+CALLBACK_HANDLE(status,     PYGEAR_TASK_EVENT_NONE)
+CALLBACK_HANDLE(warning,    PYGEAR_TASK_EVENT_NONE)
+CALLBACK_HANDLE(workload,   PYGEAR_TASK_EVENT_NONE)
+
+void _pygear_client_set_tracking_fn(gearman_client_st* g_client) {
+    // Always installed, since run_tasks relies on them to see tasks finish;
+    // they only call into Python when the matching callback is set
+    gearman_client_set_created_fn(g_client, pygear_client_wrap_callback_created);
+    gearman_client_set_complete_fn(g_client, pygear_client_wrap_callback_complete);
+    gearman_client_set_exception_fn(g_client, pygear_client_wrap_callback_exception);
+    gearman_client_set_fail_fn(g_client, pygear_client_wrap_callback_fail);
+}
 
 
 /* private method */
@@ -676,26 +1424,26 @@ static PyObject* pygear_client_set_options(pygear_ClientObject* self, PyObject*
 }
 
 
-static PyObject* pygear_client_set_serializer(pygear_ClientObject* self, PyObject* args) {
+static PyObject* pygear_client_set_serializer(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) {
     PyObject* serializer;
-    if (!PyArg_ParseTuple(args, "O", &serializer)) {
-        return NULL;
-    }
-    if (!PyObject_HasAttrString(serializer, "loads")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'loads'");
-        return NULL;
-    }
-    if (!PyObject_HasAttrString(serializer, "dumps")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'dumps'");
+    int typed_arrays;
+    if (_pygear_parse_serializer(args, kwargs, &serializer, &typed_arrays) == -1) {
         return NULL;
     }
     Py_INCREF(serializer);
     Py_XDECREF(self->serializer);
     self->serializer = serializer;
+    self->codec = _pygear_lookup_codec(serializer);
+    self->typed_arrays = typed_arrays;
     Py_RETURN_NONE;
 }
 
 
+static PyObject* pygear_client_set_compression(pygear_ClientObject* self, PyObject* args, PyObject* kwargs) {
+    return _pygear_set_compression(args, kwargs, &self->compression, self->compression_map);
+}
+
+
 static PyObject* pygear_client_set_timeout(pygear_ClientObject* self, PyObject* args) {
     int timeout;
     if (!PyArg_ParseTuple(args, "i", &timeout)) {
@@ -717,23 +1465,36 @@ static PyObject* pygear_client_unique_status(pygear_ClientObject* self, PyObject
     if (!PyArg_ParseTuple(args, "s#", &unique, &unique_len)) {
         return NULL;
     }
-    gearman_status_t status = gearman_client_unique_status(self->g_Client, unique, unique_len);
+    gearman_status_t status;
+    Py_BEGIN_ALLOW_THREADS
+    status = gearman_client_unique_status(self->g_Client, unique, unique_len);
+    Py_END_ALLOW_THREADS
     if (_pygear_check_and_raise_exn(status.status_.mesg_.result_rc)) {
         return NULL;
     }
-    PyObject* status_dict = Py_BuildValue(
-        "{s:O, s:O, s:I, s:I}",
-        "is_known", (status.status_.mesg_.is_known ? Py_True : Py_False),
-        "is_running", (status.status_.mesg_.is_running ? Py_True : Py_False),
-        "numerator", status.status_.mesg_.numerator,
-        "denominator", status.status_.mesg_.denominator
+    return _pygear_status_dict(
+        status.status_.mesg_.is_known,
+        status.status_.mesg_.is_running,
+        status.status_.mesg_.numerator,
+        status.status_.mesg_.denominator
     );
-    return status_dict;
+}
+
+
+static PyObject* pygear_client_unique_status_many(pygear_ClientObject* self, PyObject* args) {
+    PyObject* uniques;
+    if (!PyArg_ParseTuple(args, "O", &uniques)) {
+        return NULL;
+    }
+    return _pygear_client_status_many(self, uniques, 1);
 }
 
 
 static PyObject* pygear_client_wait(pygear_ClientObject* self) {
-    gearman_return_t result = gearman_client_wait(self->g_Client);
+    gearman_return_t result;
+    Py_BEGIN_ALLOW_THREADS
+    result = gearman_client_wait(self->g_Client);
+    Py_END_ALLOW_THREADS
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
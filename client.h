@@ -30,7 +30,10 @@
 #include <libgearman-1.0/gearman.h>
 #include <stdio.h>
 #include "structmember.h"
+#include "serializer.h"
 #include "task.h"
+#include "future.h"
+#include "waiter.h"
 #include "exception.h"
 
 #ifndef PyMODINIT_FUNC
@@ -42,6 +45,8 @@
 
 #define _CLIENTMETHOD(name,flags) {#name,(PyCFunction) pygear_client_##name,flags,pygear_client_##name##_doc},
 
+struct pygear_task_context;
+
 typedef struct {
     PyObject_HEAD
     struct gearman_client_st* g_Client;
@@ -55,8 +60,51 @@ typedef struct {
     PyObject* cb_fail;
     PyObject* cb_log;
     PyObject* serializer;
+    pygear_codec_t* codec;      /* native codec of serializer, borrowed */
+    int typed_arrays;           /* set_serializer(typed_arrays=...) */
+    pygear_compression_t compression;
+    PyObject* compression_map;  /* function name -> (threshold, level) */
+    struct pygear_task_context* pending;      /* queued by add_task*, FIFO */
+    struct pygear_task_context* pending_tail;
+    struct pygear_task_context* submitted;    /* handed to libgearman by run_tasks */
+    pygear_waiter_t waiter;     /* backs fileno() */
 } pygear_ClientObject;
 
+/* Signature shared by the gearman_client_add_task* variants */
+typedef gearman_task_st* (*pygear_add_task_fn)(gearman_client_st* client, gearman_task_st* task,
+    void* context, const char* function_name, const char* unique, const void* workload,
+    size_t workload_size, gearman_return_t* ret_ptr);
+
+/*
+ * Context attached to each task created by add_task*. It holds the buffer
+ * exported from the caller's workload until the job server acknowledges the
+ * task (or it is freed), since the workload is only sent by run_tasks.
+ * Tasks added to a client wait on its pending list until run_tasks submits
+ * them, which is what lets run_tasks bound the number in flight.
+ */
+typedef struct pygear_task_context {
+    pygear_ClientObject* client;
+    Py_buffer workload;
+    int has_workload;
+    struct pygear_task_context* next;   /* link in pending / submitted */
+    pygear_add_task_fn add_task;
+    char* function_name;
+    char* unique;                       /* NULL for a generated one */
+    gearman_task_st* task;              /* NULL until submitted */
+    int background;
+    int finished;                       /* no more packets expected */
+    int quiet;                          /* internal task, never shown to callbacks */
+    PyObject* future;                   /* set by submit, resolved on completion */
+} pygear_task_context;
+
+/* Task events that CALLBACK_WRAPPER reports to the task context; the task
+ * is finished from PYGEAR_TASK_EVENT_COMPLETE on */
+#define PYGEAR_TASK_EVENT_NONE      0
+#define PYGEAR_TASK_EVENT_CREATED   1
+#define PYGEAR_TASK_EVENT_COMPLETE  2
+#define PYGEAR_TASK_EVENT_EXCEPTION 3
+#define PYGEAR_TASK_EVENT_FAIL      4
+
 PyDoc_STRVAR(client_module_docstring, "Represents a Gearman client.");
 
 /* Class init methods */
@@ -65,6 +113,46 @@ int Client_traverse(pygear_ClientObject *self, visitproc visit, void *arg);
 int Client_clear(pygear_ClientObject *self);
 void Client_dealloc(pygear_ClientObject* self);
 
+/* Private methods */
+/* The add_task variant for a PYGEAR_PRIORITY_* value; NULL with ValueError if invalid */
+pygear_add_task_fn _pygear_add_task_fn(int priority, int background);
+/* Serialize and compress workload into a new task context for add_task.
+ * Returns NULL with an exception set on failure. */
+pygear_task_context* _pygear_task_context_prepare(pygear_ClientObject* self,
+    pygear_add_task_fn add_task, const char* function_name, const char* unique, PyObject* workload,
+    const pygear_compression_t* compression);
+/* Create the task for context on g_client. Returns the task, or NULL with an
+ * exception set, in which case context has been freed. */
+gearman_task_st* _pygear_client_submit(gearman_client_st* g_client, pygear_task_context* context);
+/* Queue one task per workload (uniques is None or a matching sequence) on
+ * g_client, or on the pending list of self if g_client is NULL. Tasks created
+ * on g_client right away are quiet. If tasks is not NULL it receives a PyMem
+ * array of the new tasks in order (g_client must be set). Returns the number
+ * of tasks, or -1 with an exception set and none of the tasks left behind. */
+Py_ssize_t _pygear_client_queue_tasks(pygear_ClientObject* self, gearman_client_st* g_client,
+    pygear_add_task_fn add_task, const char* function_name, PyObject* workloads, PyObject* uniques,
+    gearman_task_st*** tasks);
+/* Submit pending tasks until limit are in flight (no limit if negative).
+ * Returns the new in-flight count, or -1 with an exception set. */
+Py_ssize_t _pygear_client_submit_pending(pygear_ClientObject* self, Py_ssize_t in_flight,
+    Py_ssize_t limit);
+/* Free submitted tasks that have finished, or all of them if all_done.
+ * Returns the number still in flight. */
+Py_ssize_t _pygear_client_sweep_tasks(pygear_ClientObject* self, int all_done);
+/* Make one round of progress on queued tasks without blocking: submit
+ * pending ones up to max_in_flight (no limit if negative), run libgearman,
+ * then wait for I/O for up to timeout ms (the client timeout if negative).
+ * Returns 1 once every task has finished, 0 if some are still queued or in
+ * flight, or -1 with an exception set. */
+int _pygear_client_step(pygear_ClientObject* self, Py_ssize_t max_in_flight, int timeout);
+/* Run the client's tasks until none of the given ones is active any more,
+ * waiting for I/O through the waiter (so signals and the wait hook get a
+ * turn) for up to the client timeout at a time. Other tasks already handed
+ * to libgearman make progress too. Returns 0, or -1 with an exception set;
+ * the tasks are still the caller's to free either way. */
+int _pygear_client_run_until_done(pygear_ClientObject* self, gearman_task_st** tasks, Py_ssize_t num_tasks);
+/* Install the wrappers CALLBACK_WRAPPER uses to track task progress */
+void _pygear_client_set_tracking_fn(gearman_client_st* g_client);
 
 /* Method definitions */
 static PyObject* pygear_client_add_server(pygear_ClientObject *self, PyObject *args);
@@ -101,6 +189,48 @@ PyDoc_STRVAR(pygear_client_add_task_doc,
 "@return new Task instance on success.\n"
 "@return NULL and raises pygear exception on failure.");
 
+static PyObject* pygear_client_add_tasks(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_client_add_tasks_doc,
+"Queue one task per workload for the same function, like calling 'add_task'\n"
+"in a loop but without creating a Task object for each of them. Results\n"
+"arrive through the callbacks during 'run_tasks' as usual.\n\n"
+"@param[in] function_name - The name of the function to run.\n"
+"@param[in] workloads - Sequence or iterable of workloads.\n"
+"@param[in] uniques - Optional sequence of unique ids (or None) matching\n"
+"\tworkloads one to one.\n"
+"@param[in] priority - PYGEAR_PRIORITY_HIGH, PYGEAR_PRIORITY_NORMAL (default)\n"
+"\tor PYGEAR_PRIORITY_LOW.\n"
+"@param[in] background - True to queue background tasks.\n\n"
+"@return the number of tasks queued.\n"
+"@return NULL and raises an exception on failure. Tasks queued before the\n"
+"\tfailing workload stay queued.");
+
+static PyObject* pygear_client_submit(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_client_submit_doc,
+"Queue a foreground task like 'add_task' and return a pygear.Future for its\n"
+"result. The task is sent by 'run_tasks', 'as_completed' or Future.result(),\n"
+"and its outcome goes straight to the Future; the task callbacks still fire.\n\n"
+"@param[in] function_name - The name of the function to run.\n"
+"@param[in] workload - The workload to pass to the function when it is run.\n"
+"@param[in] unique - Optional unique job identifier, or None for a new UUID.\n"
+"@param[in] priority - PYGEAR_PRIORITY_HIGH, PYGEAR_PRIORITY_NORMAL (default)\n"
+"\tor PYGEAR_PRIORITY_LOW.\n\n"
+"@return new Future instance on success.\n"
+"@return NULL and raises an exception on failure.");
+
+static PyObject* pygear_client_as_completed(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_client_as_completed_doc,
+"Run queued tasks and iterate over futures from 'submit' as they finish.\n"
+"Futures that are already done come first.\n\n"
+"@param[in] futures - Iterable of Futures returned by this client.\n"
+"@param[in] timeout - Optional limit in seconds for the whole iteration.\n\n"
+"@return an iterator over the futures in completion order. It raises\n"
+"\tpygear.TIMEOUT if the timeout expires before all of them are done.\n\n"
+"Example:\n"
+"futures = [c.submit('reverse', s) for s in strings]\n"
+"for f in c.as_completed(futures):\n"
+"    print f.result()");
+
 static PyObject* pygear_client_add_task_background(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_client_add_task_background_doc,
 "Add a background task to be run in parallel. This task is locally queued and will only be\n"
@@ -153,17 +283,17 @@ PyDoc_STRVAR(pygear_client_do_doc,
 "Send a foreground task to server immediately and wait for its result (blocking).\n\n"
 "@param[in] function_name - The name of the function to run.\n"
 "@param[in] unique - Optional unique job identifier, or None for a new UUID.\n"
-"@param[in] workload - The workload to pass to the function when it is run.\n\n"
+"@param[in] workload - The workload to pass to the function when it is run.\n"
+"@param[in] schema - Optional pygear.Schema to encode the workload with\n"
+"\tinstead of the serializer; the worker must register the function with\n"
+"\tthe same schema. The result is still decoded by the serializer.\n\n"
 "@return the result of the task (None if empty result) on success.\n"
+"\tIn RAW mode this is a pygear.Result owning the received bytes.\n"
 "@return NULL and raises pygear exception on failure.\n\n"
-"Note: If the exception is one of GEARMAN_WORK_DATA, GEARMAN_WORK_WARNING,\n"
-"or GEARMAN_WORK_STATUS, the caller should take actions to handle the event\n"
-"and call this function again. This may happen multiple times until a\n"
-"GEARMAN_WORK_ERROR, GEARMAN_WORK_FAIL, or GEARMAN_SUCCESS (work complete)\n"
-"is returned. For GEARMAN_WORK_DATA or GEARMAN_WORK_WARNING, the result size\n"
-"will be set to the intermediate data chunk being returned and an allocated\n"
-"data buffer will be returned. For GEARMAN_WORK_STATUS, the caller can use\n"
-"'do_status' to get the current task status.");
+"The job runs as a task on the client's connection, so tasks already handed\n"
+"to libgearman make progress meanwhile, while intermediate data, warning and\n"
+"status packets of this job are skipped and none of its callbacks are\n"
+"called. Waits go through the wait hook if set, and Ctrl-C interrupts them.");
 
 static PyObject* pygear_client_do_background(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_client_do_background_doc,
@@ -171,10 +301,10 @@ PyDoc_STRVAR(pygear_client_do_background_doc,
 "the result (non-blocking).\n\n"
 "@param[in] function_name - The name of the function to run.\n"
 "@param[in] unique - Optional unique job identifier, or None for a new UUID.\n"
-"@param[in] workload - The workload to pass to the function when it is run.\n\n"
+"@param[in] workload - The workload to pass to the function when it is run.\n"
+"@param[in] schema - Optional pygear.Schema to encode the workload with.\n\n"
 "@return job_handle (string) of the task on success.\n"
-"@return NULL and raises pygear exception on failure.\n"
-"See 'do' for handling different exceptions.");
+"@return NULL and raises pygear exception on failure.");
 
 static PyObject* pygear_client_do_high(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_client_do_high_doc,
@@ -196,10 +326,28 @@ PyDoc_STRVAR(pygear_client_do_low_background_doc,
 "Run a low priority background task and return the job handle.\n"
 "See 'do_background' for parameters and return information.");
 
+static PyObject* pygear_client_do_background_many(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_client_do_background_many_doc,
+"Submit one background job per workload and return their job handles.\n"
+"Unlike calling 'do_background' in a loop, all jobs are sent before any\n"
+"acknowledgement is read, so the whole batch costs about one round trip.\n"
+"Tasks queued with add_task* are left alone and no callbacks are called\n"
+"for these jobs.\n\n"
+"@param[in] function_name - The name of the function to run.\n"
+"@param[in] workloads - Sequence or iterable of workloads.\n"
+"@param[in] uniques - Optional sequence of unique ids (or None) matching\n"
+"\tworkloads one to one.\n"
+"@param[in] priority - PYGEAR_PRIORITY_HIGH, PYGEAR_PRIORITY_NORMAL (default)\n"
+"\tor PYGEAR_PRIORITY_LOW.\n\n"
+"@return list of job handles (strings), in the order of workloads.\n"
+"@return NULL and raises pygear exception on failure. Jobs that were\n"
+"\tcreated before the failure are not rolled back.");
+
 static PyObject* pygear_client_do_job_handle(pygear_ClientObject* self);
 PyDoc_STRVAR(pygear_client_do_job_handle_doc,
 "Get the job handle for the running task. This should be used between\n"
-"repeated gearman_client_do() (and related) calls to get information.");
+"repeated gearman_client_do() (and related) calls to get information.\n"
+"'do' runs its job as a task and leaves this alone.");
 
 static PyObject* pygear_client_do_status(pygear_ClientObject* self);
 PyDoc_STRVAR(pygear_client_do_status_doc,
@@ -236,7 +384,8 @@ static PyObject* pygear_client_execute(pygear_ClientObject* self, PyObject* args
 PyDoc_STRVAR(pygear_client_execute_doc,
 "Run a task immediately and wait for the return.\n\n"
 "@param[in] function_name - The name of the function to run.\n"
-"@param[in] workload - The workload to pass to the function when it is run.\n"
+"@param[in] workload - Object supporting the buffer protocol, sent as is\n"
+"\twithout going through the serializer.\n"
 "@param[in] unique - Optional unique job identifier, or None for a new UUID.\n"
 "@param[in] name - Optional name for the gearman_argument_t.\n"
 "@return the result on success.\n"
@@ -258,13 +407,46 @@ PyDoc_STRVAR(pygear_client_job_status_doc,
 "numerator - Progress numerator.\n"
 "denominator - Progress denominator.\n");
 
+static PyObject* pygear_client_job_status_many(pygear_ClientObject* self, PyObject* args);
+PyDoc_STRVAR(pygear_client_job_status_many_doc,
+"Get the status of many background tasks by their job handles. All\n"
+"requests are sent before any answer is read, over a separate connection\n"
+"to the same servers, so polling N jobs costs about one round trip instead\n"
+"of N.\n\n"
+"@param[in] job_handles - Iterable of job handles.\n"
+"@return dictionary mapping each job handle to a dictionary like the one\n"
+"\treturned by 'job_status'.");
+
 static PyObject* pygear_client_remove_servers(pygear_ClientObject* self);
 PyDoc_STRVAR(pygear_client_remove_servers_doc,
 "Remove all servers currently associated with the client.");
 
-static PyObject* pygear_client_run_tasks(pygear_ClientObject* self);
+static PyObject* pygear_client_fileno(pygear_ClientObject* self);
+PyDoc_STRVAR(pygear_client_fileno_doc,
+"Return a file descriptor that becomes readable when 'step' can make\n"
+"progress, for use with select() or an event loop. A helper thread waits on\n"
+"the job server connections while the client is idle between steps.\n"
+"Drive the client only through 'step' while using it: any other call that\n"
+"runs tasks pauses the notifications until the next 'step'.\n\n"
+"@return the file descriptor.");
+
+static PyObject* pygear_client_step(pygear_ClientObject* self);
+PyDoc_STRVAR(pygear_client_step_doc,
+"Make as much progress as possible on queued tasks without blocking: send\n"
+"them, read replies and run callbacks or resolve futures. Call it once to\n"
+"start and then whenever 'fileno' is readable.\n\n"
+"@return True once every queued task has finished, False otherwise.\n"
+"@return NULL and raises pygear exception on failure.");
+
+static PyObject* pygear_client_run_tasks(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_client_run_tasks_doc,
-"Run tasks that have been added by 'add_task' and/or 'add_task_background'.\n\n"
+"Run tasks that have been added by 'add_task' and/or 'add_task_background'.\n"
+"Each workload is released as soon as the job server acknowledges its task,\n"
+"and finished tasks are freed before returning.\n\n"
+"@param[in] max_in_flight - Optional limit on the number of tasks sent to the\n"
+"\tjob server and not yet finished. More tasks are sent as earlier ones\n"
+"\tfinish, which bounds memory use on both sides for large batches.\n"
+"\tNone (the default) sends every task at once.\n\n"
 "@return None on success.\n"
 "@return NULL and raises pygear exception on failure.");
 
@@ -327,15 +509,31 @@ PyDoc_STRVAR(pygear_client_set_options_doc,
 "@return None on success, NULL on failure.");
 
 
-static PyObject* pygear_client_set_serializer(pygear_ClientObject* self, PyObject* args);
+static PyObject* pygear_client_set_serializer(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_client_set_serializer_doc,
 "Specify the object to be used to serialize data passed through gearman.\n"
 "By default, pygear will use 'json' to convert data to a string\n"
 "representation during transit and reconstitute it on the other end.\n"
 "You can replace the serializer with your own as long as it implements\n"
 "the 'dumps' and 'loads' methods. 'dumps' must return a string, and loads\n"
-"must take a string.\n\n"
-"@param[in] serializer - Object implementing dumps and loads");
+"must take a string. Pass None (pygear.RAW) to skip serialization and\n"
+"send and receive plain strings.\n\n"
+"@param[in] serializer - Object implementing dumps and loads, or None\n"
+"@param[in] typed_arrays - If True, send array.array and other 1-D numeric\n"
+"\tbuffers as raw little-endian elements instead of serializing them, and\n"
+"\tdecode such results back to array.array. Workers need it too.");
+
+static PyObject* pygear_client_set_compression(pygear_ClientObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_client_set_compression_doc,
+"Compress workloads with zlib when their serialized size reaches\n"
+"'threshold' bytes. Workers (pygear ones, of any configuration) unpack them\n"
+"before the job sees its workload. Payloads that zlib cannot shrink are\n"
+"sent as they are, and RAW mode is never compressed.\n\n"
+"@param[in] threshold - Smallest workload size to compress, or None to turn\n"
+"\tcompression off (the default).\n"
+"@param[in] level - Optional zlib level, 0-9, or -1 for zlib's default.\n"
+"@param[in] function - Optional function name whose tasks get these settings\n"
+"\tinstead of the client-wide ones.");
 
 static PyObject* pygear_client_set_status_fn(pygear_ClientObject* self, PyObject* args);
 PyDoc_STRVAR(pygear_client_set_status_fn_doc,
@@ -375,6 +573,14 @@ PyDoc_STRVAR(pygear_client_unique_status_doc,
 "numerator - Progress numerator.\n"
 "denominator - Progress denominator.");
 
+static PyObject* pygear_client_unique_status_many(pygear_ClientObject* self, PyObject* args);
+PyDoc_STRVAR(pygear_client_unique_status_many_doc,
+"Get the status of many background tasks by their unique identifiers, with\n"
+"the requests pipelined as in 'job_status_many'.\n\n"
+"@param[in] uniques - Iterable of unique identifiers.\n"
+"@return dictionary mapping each unique identifier to a dictionary like the\n"
+"\tone returned by 'unique_status'.");
+
 static PyObject* pygear_client_wait(pygear_ClientObject* self);
 PyDoc_STRVAR(pygear_client_wait_doc,
 "When in non-blocking I/O mode, wait for activity from one of the servers.\n\n"
@@ -399,12 +605,18 @@ static PyMethodDef client_module_methods[] = {
     _CLIENTMETHOD(add_task_high_background, METH_VARARGS | METH_KEYWORDS)
     _CLIENTMETHOD(add_task_low,             METH_VARARGS | METH_KEYWORDS)
     _CLIENTMETHOD(add_task_low_background,  METH_VARARGS | METH_KEYWORDS)
+    _CLIENTMETHOD(add_tasks,                METH_VARARGS | METH_KEYWORDS)
+    _CLIENTMETHOD(submit,                   METH_VARARGS | METH_KEYWORDS)
+    _CLIENTMETHOD(as_completed,             METH_VARARGS | METH_KEYWORDS)
     _CLIENTMETHOD(add_task_status,          METH_VARARGS)
     _CLIENTMETHOD(execute,                  METH_VARARGS | METH_KEYWORDS)
-    _CLIENTMETHOD(run_tasks,                METH_NOARGS)
+    _CLIENTMETHOD(run_tasks,                METH_VARARGS | METH_KEYWORDS)
+    _CLIENTMETHOD(step,                     METH_NOARGS)
+    _CLIENTMETHOD(fileno,                   METH_NOARGS)
     _CLIENTMETHOD(wait,                     METH_NOARGS)
     _CLIENTMETHOD(do,                       METH_VARARGS | METH_KEYWORDS)
     _CLIENTMETHOD(do_background,            METH_VARARGS | METH_KEYWORDS)
+    _CLIENTMETHOD(do_background_many,       METH_VARARGS | METH_KEYWORDS)
     _CLIENTMETHOD(do_high,                  METH_VARARGS | METH_KEYWORDS)
     _CLIENTMETHOD(do_high_background,       METH_VARARGS | METH_KEYWORDS)
     _CLIENTMETHOD(do_low,                   METH_VARARGS | METH_KEYWORDS)
@@ -419,7 +631,9 @@ static PyMethodDef client_module_methods[] = {
     _CLIENTMETHOD(do_job_handle,            METH_VARARGS)
     _CLIENTMETHOD(do_status,                METH_NOARGS)
     _CLIENTMETHOD(job_status,               METH_VARARGS)
+    _CLIENTMETHOD(job_status_many,          METH_VARARGS)
     _CLIENTMETHOD(unique_status,            METH_VARARGS)
+    _CLIENTMETHOD(unique_status_many,       METH_VARARGS)
 
     // Callbacks
     _CLIENTMETHOD(set_workload_fn,          METH_VARARGS)
@@ -438,7 +652,8 @@ static PyMethodDef client_module_methods[] = {
     _CLIENTMETHOD(get_options,              METH_NOARGS)
     _CLIENTMETHOD(timeout,                  METH_NOARGS)
     _CLIENTMETHOD(set_timeout,              METH_VARARGS)
-    _CLIENTMETHOD(set_serializer,           METH_VARARGS)
+    _CLIENTMETHOD(set_serializer,           METH_VARARGS | METH_KEYWORDS)
+    _CLIENTMETHOD(set_compression,          METH_VARARGS | METH_KEYWORDS)
 
     {NULL, NULL, 0, NULL}
 };
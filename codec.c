@@ -0,0 +1,78 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "codec.h"
+
+/*
+ * Class constructor / destructor methods
+ */
+
+int Codec_bind(pygear_CodecObject* self, pygear_codec_t* codec) {
+    self->codec = codec;
+    self->capsule = PyCapsule_New(codec, PYGEAR_CODEC_CAPSULE, NULL);
+    return (self->capsule ? 0 : -1);
+}
+
+PyObject* _pygear_codec_object_new(PyTypeObject* type, pygear_codec_t* codec) {
+    pygear_CodecObject* self = (pygear_CodecObject*) type->tp_alloc(type, 0);
+    if (!self) {
+        return NULL;
+    }
+    if (Codec_bind(self, codec) == -1) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject*) self;
+}
+
+void Codec_dealloc(pygear_CodecObject* self) {
+    Py_CLEAR(self->capsule);
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+/*
+ * Instance Methods
+ */
+
+static PyObject* pygear_codec_dumps(pygear_CodecObject* self, PyObject* args) {
+    PyObject* obj;
+    if (!PyArg_ParseTuple(args, "O", &obj)) {
+        return NULL;
+    }
+    return self->codec->encode(self->codec->state, obj);
+}
+
+static PyObject* pygear_codec_loads(pygear_CodecObject* self, PyObject* args) {
+    Py_buffer data;
+    if (!PyArg_ParseTuple(args, "s*", &data)) {
+        return NULL;
+    }
+    PyObject* ret = self->codec->decode(self->codec->state, data.buf, data.len);
+    PyBuffer_Release(&data);
+    return ret;
+}
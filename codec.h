@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include <stdio.h>
+#include "structmember.h"
+#include "serializer.h"
+
+#ifndef PyMODINIT_FUNC
+#define PyMODINIT_FUNC void
+#endif
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#define _CODECMETHOD(name,flags) {#name,(PyCFunction) pygear_codec_##name,flags,pygear_codec_##name##_doc},
+
+typedef struct {
+    PyObject_HEAD
+    pygear_codec_t* codec;
+    PyObject* capsule;      /* exposed as _pygear_codec */
+} pygear_CodecObject;
+
+PyDoc_STRVAR(codec_module_docstring,
+"A serializer implemented in C. Passing one to set_serializer makes pygear\n"
+"call the codec directly instead of looking up and calling 'dumps' and\n"
+"'loads' for every message. The methods below are there for use from\n"
+"Python and for compatibility with the plain serializer protocol.");
+
+/* Class init methods */
+PyObject* _pygear_codec_object_new(PyTypeObject* type, pygear_codec_t* codec);
+int Codec_bind(pygear_CodecObject* self, pygear_codec_t* codec);
+void Codec_dealloc(pygear_CodecObject* self);
+
+
+/* Method definitions */
+static PyObject* pygear_codec_dumps(pygear_CodecObject* self, PyObject* args);
+PyDoc_STRVAR(pygear_codec_dumps_doc,
+"Encode an object.\n"
+"@param[in] obj Object to encode\n"
+"@return the encoded str");
+
+static PyObject* pygear_codec_loads(pygear_CodecObject* self, PyObject* args);
+PyDoc_STRVAR(pygear_codec_loads_doc,
+"Decode a payload.\n"
+"@param[in] data str or other buffer holding an encoded payload\n"
+"@return the decoded object");
+
+/* Module method specification */
+static PyMethodDef codec_module_methods[] = {
+    _CODECMETHOD(dumps, METH_VARARGS)
+    _CODECMETHOD(loads, METH_VARARGS)
+    {NULL, NULL, 0, NULL}
+};
+
+static PyMemberDef codec_module_members[] = {
+    {PYGEAR_CODEC_ATTR, T_OBJECT, offsetof(pygear_CodecObject, capsule), READONLY,
+     "Capsule holding the pygear_codec_t used by the extension"},
+    {NULL}
+};
+
+PyTypeObject pygear_CodecType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                          /*ob_size*/
+    "pygear.Codec",                             /*tp_name*/
+    sizeof(pygear_CodecObject),                 /*tp_basicsize*/
+    0,                                          /*tp_itemsize*/
+    (destructor)Codec_dealloc,                  /*tp_dealloc*/
+    0,                                          /*tp_print*/
+    0,                                          /*tp_getattr*/
+    0,                                          /*tp_setattr*/
+    0,                                          /*tp_compare*/
+    0,                                          /*tp_repr*/
+    0,                                          /*tp_as_number*/
+    0,                                          /*tp_as_sequence*/
+    0,                                          /*tp_as_mapping*/
+    0,                                          /*tp_hash */
+    0,                                          /*tp_call*/
+    0,                                          /*tp_str*/
+    0,                                          /*tp_getattro*/
+    0,                                          /*tp_setattro*/
+    0,                                          /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT |
+    Py_TPFLAGS_BASETYPE,                        /*tp_flags*/
+    codec_module_docstring,                     /* tp_doc */
+    0,                                          /* tp_traverse */
+    0,                                          /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    0,                                          /* tp_iter */
+    0,                                          /* tp_iternext */
+    codec_module_methods,                       /* tp_methods */
+    codec_module_members,                       /* tp_members */
+};
+
+#endif
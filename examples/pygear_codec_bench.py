@@ -0,0 +1,59 @@
+"""Compare pygear.MSGPACK with json and cPickle on typical job payloads.
+
+Reports the encoded size and the encode/decode time per payload. No gearman
+server is needed.
+
+    python examples/pygear_codec_bench.py [-n ITERATIONS]
+"""
+import cPickle
+import json
+import optparse
+import timeit
+
+import pygear
+
+
+class PickleSerializer(object):
+    @staticmethod
+    def dumps(obj):
+        return cPickle.dumps(obj, cPickle.HIGHEST_PROTOCOL)
+
+    loads = staticmethod(cPickle.loads)
+
+
+SERIALIZERS = [
+    ('json', json),
+    ('cPickle', PickleSerializer),
+    ('MSGPACK', pygear.MSGPACK),
+]
+
+PAYLOADS = [
+    ('small dict', {u'id': 12345, u'name': u'resize', u'ok': True, u'ratio': 0.75}),
+    ('int list', range(1000)),
+    ('float list', [i * 0.5 for i in range(1000)]),
+    ('nested records', [
+        {u'user': u'user%d' % i, u'tags': [u'a', u'b', u'c'], u'score': i * 1.5, u'active': i % 2 == 0}
+        for i in range(200)
+    ]),
+    ('text', {u'body': u'lorem ipsum dolor sit amet ' * 200}),
+]
+
+
+def main():
+    parser = optparse.OptionParser()
+    parser.add_option('-n', '--iterations', type='int', default=2000)
+    opts, _ = parser.parse_args()
+
+    print '%-16s %-8s %10s %12s %12s' % ('payload', 'codec', 'bytes', 'dumps (us)', 'loads (us)')
+    for payload_name, payload in PAYLOADS:
+        for name, serializer in SERIALIZERS:
+            encoded = serializer.dumps(payload)
+            dumps_time = timeit.timeit(lambda: serializer.dumps(payload), number=opts.iterations)
+            loads_time = timeit.timeit(lambda: serializer.loads(encoded), number=opts.iterations)
+            print '%-16s %-8s %10d %12.2f %12.2f' % (
+                payload_name, name, len(encoded),
+                dumps_time * 1e6 / opts.iterations, loads_time * 1e6 / opts.iterations)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,376 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/time.h>
+#include "future.h"
+#include "client.h"
+
+/*
+ * Class constructor / destructor methods
+ */
+
+PyObject* _pygear_future_new(PyObject* client) {
+    pygear_FutureObject* self = (pygear_FutureObject*) pygear_FutureType.tp_alloc(&pygear_FutureType, 0);
+    if (!self) {
+        return NULL;
+    }
+    Py_INCREF(client);
+    self->client = client;
+    return (PyObject*) self;
+}
+
+int Future_traverse(pygear_FutureObject* self, visitproc visit, void* arg) {
+    Py_VISIT(self->client);
+    Py_VISIT(self->result);
+    Py_VISIT(self->exception);
+    return 0;
+}
+
+int Future_clear(pygear_FutureObject* self) {
+    Py_CLEAR(self->client);
+    Py_CLEAR(self->result);
+    Py_CLEAR(self->exception);
+    return 0;
+}
+
+void Future_dealloc(pygear_FutureObject* self) {
+    PyObject_GC_UnTrack(self);
+    Future_clear(self);
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+
+/*
+ * Completion
+ */
+
+/* private method */
+static void _pygear_future_finish(pygear_FutureObject* self) {
+    self->done = 1;
+    if (self->waiter) {
+        if (PyList_Append(self->waiter->ready, (PyObject*) self) == -1) {
+            PyErr_Print();
+        }
+        self->waiter = NULL;
+    }
+}
+
+/* private method, takes over the exception currently set */
+static void _pygear_future_set_error(pygear_FutureObject* self) {
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+    self->exception = value;
+    _pygear_future_finish(self);
+}
+
+/* private method, same decoding as Task.result */
+static PyObject* _pygear_future_task_data(PyObject* serializer, pygear_codec_t* codec,
+    int typed_arrays, gearman_task_st* gear_task, PyObject* raw_result) {
+    if (PYGEAR_IS_RAW(serializer)) {
+        Py_XINCREF(raw_result);
+        return raw_result;
+    }
+    const char* task_result = gearman_task_data(gear_task);
+    if (!task_result) {
+        Py_RETURN_NONE;
+    }
+    return _pygear_deserialize(serializer, codec, typed_arrays, task_result, gearman_task_data_size(gear_task));
+}
+
+void _pygear_future_task_event(PyObject* future, PyObject* serializer, pygear_codec_t* codec,
+    int typed_arrays, gearman_task_st* gear_task, PyObject* raw_result, int event) {
+    pygear_FutureObject* self = (pygear_FutureObject*) future;
+    if (self->done) {
+        return;
+    }
+    if (event == PYGEAR_TASK_EVENT_COMPLETE) {
+        // A result that fails to decode fails the future instead
+        self->result = _pygear_future_task_data(serializer, codec, typed_arrays, gear_task, raw_result);
+        if (self->result) {
+            _pygear_future_finish(self);
+            return;
+        }
+        _pygear_future_set_error(self);
+        return;
+    }
+    _pygear_check_and_raise_exn(event == PYGEAR_TASK_EVENT_EXCEPTION ? GEARMAN_WORK_EXCEPTION : GEARMAN_WORK_FAIL);
+    _pygear_future_set_error(self);
+    if (event == PYGEAR_TASK_EVENT_EXCEPTION && self->exception) {
+        PyObject* details = _pygear_future_task_data(serializer, codec, typed_arrays, gear_task, raw_result);
+        if (!details || PyObject_SetAttrString(self->exception, "details", details) == -1) {
+            PyErr_Clear();
+        }
+        Py_XDECREF(details);
+    }
+}
+
+void _pygear_future_abandon(PyObject* future, gearman_return_t returncode) {
+    pygear_FutureObject* self = (pygear_FutureObject*) future;
+    if (self->done) {
+        return;
+    }
+    if (!_pygear_check_and_raise_exn(returncode)) {
+        _pygear_check_and_raise_exn(GEARMAN_WORK_FAIL);
+    }
+    _pygear_future_set_error(self);
+}
+
+
+/*
+ * Waiting
+ */
+
+/* private method, in seconds */
+static double _pygear_future_now(void) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/* private method, a negative deadline for a None timeout */
+static int _pygear_future_deadline(PyObject* timeout, double* deadline) {
+    *deadline = -1;
+    if (timeout == Py_None) {
+        return 0;
+    }
+    double seconds = PyFloat_AsDouble(timeout);
+    if (seconds == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (seconds < 0) {
+        PyErr_SetString(PyExc_ValueError, "timeout must be a non-negative number or None");
+        return -1;
+    }
+    *deadline = _pygear_future_now() + seconds;
+    return 0;
+}
+
+/* private method; drive client until ready(arg) holds. Returns 0, or -1 with
+ * an exception set, pygear.TIMEOUT once a non-negative deadline has passed */
+static int _pygear_future_drive(PyObject* client, double deadline, int (*ready)(PyObject*), PyObject* arg) {
+    while (!ready(arg)) {
+        if (!client) {
+            PyErr_SetString(PyGearExn_ERROR, "Future is no longer attached to a client");
+            return -1;
+        }
+        int timeout = -1;
+        if (deadline >= 0) {
+            double remaining = deadline - _pygear_future_now();
+            if (remaining <= 0) {
+                PyErr_SetString(PyGearExn_TIMEOUT, "Timed out waiting for futures");
+                return -1;
+            }
+            timeout = (int) (remaining * 1000) + 1;
+        }
+        int status = _pygear_client_step((pygear_ClientObject*) client, -1, timeout);
+        if (status == -1) {
+            return -1;
+        }
+        if (status == 1 && !ready(arg)) {
+            PyErr_SetString(PyGearExn_ERROR, "Client has no queued task left for these futures");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* private method */
+static int _pygear_future_is_done(PyObject* future) {
+    return ((pygear_FutureObject*) future)->done;
+}
+
+/* private method */
+static int _pygear_future_wait(pygear_FutureObject* self, PyObject* args, PyObject* kwargs) {
+    PyObject* timeout = Py_None;
+    static char* kwlist[] = {"timeout", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &timeout)) {
+        return -1;
+    }
+    double deadline;
+    if (_pygear_future_deadline(timeout, &deadline) == -1) {
+        return -1;
+    }
+    return _pygear_future_drive(self->client, deadline, _pygear_future_is_done, (PyObject*) self);
+}
+
+
+/********************
+ * Instance methods *
+ ********************
+ */
+
+static PyObject* pygear_future_done(pygear_FutureObject* self) {
+    return PyBool_FromLong(self->done);
+}
+
+static PyObject* pygear_future_result(pygear_FutureObject* self, PyObject* args, PyObject* kwargs) {
+    if (_pygear_future_wait(self, args, kwargs) == -1) {
+        return NULL;
+    }
+    if (self->exception) {
+        PyErr_SetObject((PyObject*) Py_TYPE(self->exception), self->exception);
+        return NULL;
+    }
+    Py_INCREF(self->result);
+    return self->result;
+}
+
+static PyObject* pygear_future_exception(pygear_FutureObject* self, PyObject* args, PyObject* kwargs) {
+    if (_pygear_future_wait(self, args, kwargs) == -1) {
+        return NULL;
+    }
+    PyObject* exception = (self->exception ? self->exception : Py_None);
+    Py_INCREF(exception);
+    return exception;
+}
+
+
+/*
+ * as_completed iterator
+ */
+
+PyObject* _pygear_future_iterator_new(PyObject* client, PyObject* futures, PyObject* timeout) {
+    pygear_FutureIteratorObject* self = (pygear_FutureIteratorObject*)
+        pygear_FutureIteratorType.tp_alloc(&pygear_FutureIteratorType, 0);
+    if (!self) {
+        return NULL;
+    }
+    Py_ssize_t i;
+    Py_INCREF(client);
+    self->client = client;
+    self->ready = PyList_New(0);
+    PyObject* distinct = PyList_New(0);
+    PyObject* future_seq = PySequence_Fast(futures, "futures must be iterable");
+    if (!self->ready || !distinct || !future_seq ||
+        _pygear_future_deadline(timeout, &self->deadline) == -1) {
+        goto error;
+    }
+    // Mark each future with its waiter first, which also drops duplicates
+    Py_ssize_t num_futures = PySequence_Fast_GET_SIZE(future_seq);
+    for (i = 0; i < num_futures; ++i) {
+        PyObject* item = PySequence_Fast_GET_ITEM(future_seq, i);
+        if (!PyObject_TypeCheck(item, &pygear_FutureType)) {
+            PyErr_SetString(PyExc_TypeError, "as_completed only accepts pygear.Future objects");
+            goto error;
+        }
+        pygear_FutureObject* future = (pygear_FutureObject*) item;
+        if (future->waiter == self) {
+            continue;
+        }
+        if (future->client != client) {
+            PyErr_SetString(PyExc_ValueError, "Future was submitted by another client");
+            goto error;
+        }
+        if (future->waiter) {
+            PyErr_SetString(PyExc_ValueError, "Future is already waited on by another as_completed");
+            goto error;
+        }
+        if (PyList_Append(distinct, item) == -1) {
+            goto error;
+        }
+        future->waiter = self;
+    }
+    self->futures = PyList_AsTuple(distinct);
+    if (!self->futures) {
+        goto error;
+    }
+    for (i = 0; i < PyTuple_GET_SIZE(self->futures); ++i) {
+        pygear_FutureObject* future = (pygear_FutureObject*) PyTuple_GET_ITEM(self->futures, i);
+        if (future->done) {
+            future->waiter = NULL;
+            if (PyList_Append(self->ready, (PyObject*) future) == -1) {
+                goto error;
+            }
+        }
+    }
+    Py_DECREF(distinct);
+    Py_DECREF(future_seq);
+    return (PyObject*) self;
+
+error:
+    if (distinct) {
+        for (i = 0; i < PyList_GET_SIZE(distinct); ++i) {
+            ((pygear_FutureObject*) PyList_GET_ITEM(distinct, i))->waiter = NULL;
+        }
+    }
+    Py_XDECREF(distinct);
+    Py_XDECREF(future_seq);
+    Py_DECREF(self);
+    return NULL;
+}
+
+int FutureIterator_traverse(pygear_FutureIteratorObject* self, visitproc visit, void* arg) {
+    Py_VISIT(self->client);
+    Py_VISIT(self->futures);
+    Py_VISIT(self->ready);
+    return 0;
+}
+
+int FutureIterator_clear(pygear_FutureIteratorObject* self) {
+    if (self->futures) {
+        Py_ssize_t i;
+        for (i = 0; i < PyTuple_GET_SIZE(self->futures); ++i) {
+            pygear_FutureObject* future = (pygear_FutureObject*) PyTuple_GET_ITEM(self->futures, i);
+            if (future->waiter == self) {
+                future->waiter = NULL;
+            }
+        }
+    }
+    Py_CLEAR(self->client);
+    Py_CLEAR(self->futures);
+    Py_CLEAR(self->ready);
+    return 0;
+}
+
+void FutureIterator_dealloc(pygear_FutureIteratorObject* self) {
+    PyObject_GC_UnTrack(self);
+    FutureIterator_clear(self);
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+/* private method */
+static int _pygear_future_iterator_has_ready(PyObject* iterator) {
+    pygear_FutureIteratorObject* self = (pygear_FutureIteratorObject*) iterator;
+    return self->next_ready < PyList_GET_SIZE(self->ready);
+}
+
+PyObject* FutureIterator_next(pygear_FutureIteratorObject* self) {
+    if (!self->futures || self->next_ready == PyTuple_GET_SIZE(self->futures)) {
+        return NULL;
+    }
+    if (_pygear_future_drive(self->client, self->deadline, _pygear_future_iterator_has_ready,
+        (PyObject*) self) == -1) {
+        return NULL;
+    }
+    PyObject* future = PyList_GET_ITEM(self->ready, self->next_ready++);
+    Py_INCREF(future);
+    return future;
+}
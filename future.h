@@ -0,0 +1,189 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include <libgearman-1.0/gearman.h>
+#include <stdio.h>
+#include "structmember.h"
+#include "serializer.h"
+#include "result.h"
+
+#ifndef PyMODINIT_FUNC
+#define PyMODINIT_FUNC void
+#endif
+
+#ifndef FUTURE_H
+#define FUTURE_H
+
+#define _FUTUREMETHOD(name,flags) {#name,(PyCFunction) pygear_future_##name,flags,pygear_future_##name##_doc},
+
+struct pygear_FutureIteratorObject;
+
+typedef struct {
+    PyObject_HEAD
+    PyObject* client;       /* pygear.Client that runs the task */
+    int done;
+    PyObject* result;
+    PyObject* exception;    /* set instead of result when the job failed */
+    struct pygear_FutureIteratorObject* waiter;  /* as_completed iterator, borrowed */
+} pygear_FutureObject;
+
+/* Iterator returned by Client.as_completed */
+typedef struct pygear_FutureIteratorObject {
+    PyObject_HEAD
+    PyObject* client;
+    PyObject* futures;      /* tuple of the distinct futures waited on */
+    PyObject* ready;        /* list of done futures, in completion order */
+    Py_ssize_t next_ready;  /* index in ready of the next one to yield */
+    double deadline;        /* negative for none */
+} pygear_FutureIteratorObject;
+
+PyDoc_STRVAR(future_module_docstring,
+"The pending result of a task queued with Client.submit. The client sends\n"
+"the task and reads its outcome whenever it runs tasks, so calling result()\n"
+"on a future that is not done runs the client's queued tasks until it is.");
+
+PyDoc_STRVAR(future_iterator_module_docstring,
+"Iterator over futures in completion order, see Client.as_completed.");
+
+/* Class init methods */
+int Future_traverse(pygear_FutureObject* self, visitproc visit, void* arg);
+int Future_clear(pygear_FutureObject* self);
+void Future_dealloc(pygear_FutureObject* self);
+int FutureIterator_traverse(pygear_FutureIteratorObject* self, visitproc visit, void* arg);
+int FutureIterator_clear(pygear_FutureIteratorObject* self);
+void FutureIterator_dealloc(pygear_FutureIteratorObject* self);
+PyObject* FutureIterator_next(pygear_FutureIteratorObject* self);
+
+/* Private methods */
+PyObject* _pygear_future_new(PyObject* client);
+/* Resolve future from a finished task, for a PYGEAR_TASK_EVENT_* from
+ * PYGEAR_TASK_EVENT_COMPLETE on. In RAW mode raw_result is what
+ * _pygear_task_take_result returned for the task (NULL with an exception
+ * set if that failed). Errors end up in the future. */
+void _pygear_future_task_event(PyObject* future, PyObject* serializer, pygear_codec_t* codec,
+    int typed_arrays, gearman_task_st* gear_task, PyObject* raw_result, int event);
+/* Fail future, if still pending, for a task that ended without a result */
+void _pygear_future_abandon(PyObject* future, gearman_return_t returncode);
+PyObject* _pygear_future_iterator_new(PyObject* client, PyObject* futures, PyObject* timeout);
+
+/* Method definitions */
+static PyObject* pygear_future_done(pygear_FutureObject* self);
+PyDoc_STRVAR(pygear_future_done_doc,
+"Return True if the task has finished, successfully or not.");
+
+static PyObject* pygear_future_result(pygear_FutureObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_future_result_doc,
+"Return the result of the task, running the client's queued tasks until\n"
+"it is done.\n\n"
+"@param[in] timeout - Optional limit in seconds, None to wait as long as the\n"
+"\tclient timeout allows.\n\n"
+"@return the deserialized result, or a pygear.Result in RAW mode.\n"
+"@return NULL and raises the error of the job (pygear.WORK_FAIL,\n"
+"\tpygear.WORK_EXCEPTION, ...) or pygear.TIMEOUT.");
+
+static PyObject* pygear_future_exception(pygear_FutureObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_future_exception_doc,
+"Like 'result', but return the exception the job failed with, or None if\n"
+"it succeeded. For pygear.WORK_EXCEPTION the exception data sent by the\n"
+"worker, if any, is in its 'details' attribute.");
+
+/* Module method specification */
+static PyMethodDef future_module_methods[] = {
+    _FUTUREMETHOD(done, METH_NOARGS)
+    _FUTUREMETHOD(result, METH_VARARGS | METH_KEYWORDS)
+    _FUTUREMETHOD(exception, METH_VARARGS | METH_KEYWORDS)
+    {NULL, NULL, 0, NULL}
+};
+
+PyTypeObject pygear_FutureType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                          /*ob_size*/
+    "pygear.Future",                            /*tp_name*/
+    sizeof(pygear_FutureObject),                /*tp_basicsize*/
+    0,                                          /*tp_itemsize*/
+    (destructor)Future_dealloc,                 /*tp_dealloc*/
+    0,                                          /*tp_print*/
+    0,                                          /*tp_getattr*/
+    0,                                          /*tp_setattr*/
+    0,                                          /*tp_compare*/
+    0,                                          /*tp_repr*/
+    0,                                          /*tp_as_number*/
+    0,                                          /*tp_as_sequence*/
+    0,                                          /*tp_as_mapping*/
+    0,                                          /*tp_hash */
+    0,                                          /*tp_call*/
+    0,                                          /*tp_str*/
+    0,                                          /*tp_getattro*/
+    0,                                          /*tp_setattro*/
+    0,                                          /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT |
+    Py_TPFLAGS_HAVE_GC,                         /*tp_flags*/
+    future_module_docstring,                    /* tp_doc */
+    (traverseproc)Future_traverse,              /* tp_traverse */
+    (inquiry)Future_clear,                      /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    0,                                          /* tp_iter */
+    0,                                          /* tp_iternext */
+    future_module_methods,                      /* tp_methods */
+};
+
+PyTypeObject pygear_FutureIteratorType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                          /*ob_size*/
+    "pygear.FutureIterator",                    /*tp_name*/
+    sizeof(pygear_FutureIteratorObject),        /*tp_basicsize*/
+    0,                                          /*tp_itemsize*/
+    (destructor)FutureIterator_dealloc,         /*tp_dealloc*/
+    0,                                          /*tp_print*/
+    0,                                          /*tp_getattr*/
+    0,                                          /*tp_setattr*/
+    0,                                          /*tp_compare*/
+    0,                                          /*tp_repr*/
+    0,                                          /*tp_as_number*/
+    0,                                          /*tp_as_sequence*/
+    0,                                          /*tp_as_mapping*/
+    0,                                          /*tp_hash */
+    0,                                          /*tp_call*/
+    0,                                          /*tp_str*/
+    0,                                          /*tp_getattro*/
+    0,                                          /*tp_setattro*/
+    0,                                          /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT |
+    Py_TPFLAGS_HAVE_GC,                         /*tp_flags*/
+    future_iterator_module_docstring,           /* tp_doc */
+    (traverseproc)FutureIterator_traverse,      /* tp_traverse */
+    (inquiry)FutureIterator_clear,              /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    PyObject_SelfIter,                          /* tp_iter */
+    (iternextfunc)FutureIterator_next,          /* tp_iternext */
+};
+
+#endif
@@ -34,11 +34,16 @@
 
 int Job_init(pygear_JobObject* self, PyObject* args, PyObject* kwds) {
     self->g_Job = NULL;
-    self->serializer = PyImport_ImportModule(PYTHON_SERIALIZER);
+    self->workload = NULL;
+    self->schema = NULL;
+    self->compression = _pygear_compression_off;
+    self->exports = 0;
+    self->owned_workload = NULL;
+    self->owned_workload_size = 0;
+    self->serializer = _pygear_default_serializer();
+    self->codec = NULL;
+    self->typed_arrays = 0;
     if (self->serializer == NULL) {
-        PyObject* err_string = PyString_FromFormat("Failed to import '%s'", PYTHON_SERIALIZER);
-        PyErr_SetObject(PyExc_ImportError, err_string);
-        Py_XDECREF(err_string);
         return -1;
     }
     return 0;
@@ -46,43 +51,130 @@ int Job_init(pygear_JobObject* self, PyObject* args, PyObject* kwds) {
 
 int Job_traverse(pygear_JobObject* self, visitproc visit, void* arg) {
     Py_VISIT(self->serializer);
+    Py_VISIT(self->workload);
+    Py_VISIT(self->schema);
     return 0;
 }
 
 int Job_clear(pygear_JobObject* self) {
     Py_CLEAR(self->serializer);
+    Py_CLEAR(self->workload);
+    Py_CLEAR(self->schema);
     return 0;
 }
 
+static pygear_JobObject* _pygear_job_freelist[PYGEAR_JOB_FREELIST_MAX];
+static int _pygear_job_freelist_size = 0;
+static unsigned long _pygear_job_freelist_reused = 0;
+
 void Job_dealloc(pygear_JobObject* self) {
+    PyObject_GC_UnTrack(self);
     if (self->g_Job) {
         gearman_job_free(self->g_Job);
         self->g_Job = NULL;
     }
+    free(self->owned_workload);
+    self->owned_workload = NULL;
     Job_clear(self);
+    if (Py_TYPE(self) == &pygear_JobType && _pygear_job_freelist_size < PYGEAR_JOB_FREELIST_MAX) {
+        _pygear_job_freelist[_pygear_job_freelist_size++] = self;
+        return;
+    }
     self->ob_type->tp_free((PyObject*)self);
 }
 
+pygear_JobObject* _pygear_job_new(PyObject* serializer, pygear_codec_t* codec, int typed_arrays,
+    gearman_job_st* g_Job) {
+    pygear_JobObject* self;
+    if (_pygear_job_freelist_size > 0) {
+        // Fields were cleared by Job_dealloc, so only the refcount needs resetting
+        self = _pygear_job_freelist[--_pygear_job_freelist_size];
+        _Py_NewReference((PyObject*) self);
+        ++_pygear_job_freelist_reused;
+        PyObject_GC_Track(self);
+    } else {
+        self = (pygear_JobObject*) pygear_JobType.tp_alloc(&pygear_JobType, 0);
+        if (!self) {
+            return NULL;
+        }
+    }
+    Py_INCREF(serializer);
+    self->serializer = serializer;
+    self->codec = codec;
+    self->typed_arrays = typed_arrays;
+    self->compression = _pygear_compression_off;
+    self->g_Job = g_Job;
+    return self;
+}
+
+PyObject* _pygear_job_freelist_stats(void) {
+    return Py_BuildValue(
+        "{s:i, s:i, s:k}",
+        "size", _pygear_job_freelist_size,
+        "max", PYGEAR_JOB_FREELIST_MAX,
+        "reused", _pygear_job_freelist_reused
+    );
+}
+
 /*
- * Instance Methods
+ * Buffer protocol
  */
 
-static PyObject* pygear_job_set_serializer(pygear_JobObject* self, PyObject* args) {
-    PyObject* serializer;
-    if (!PyArg_ParseTuple(args, "O", &serializer)) {
-        return NULL;
+int Job_getbuffer(pygear_JobObject* self, Py_buffer* view, int flags) {
+    void* data;
+    Py_ssize_t size;
+    if (self->owned_workload) {
+        data = self->owned_workload;
+        size = self->owned_workload_size;
+    } else if (self->g_Job) {
+        data = (void*) gearman_job_workload(self->g_Job);
+        size = gearman_job_workload_size(self->g_Job);
+    } else {
+        PyErr_SetString(PyExc_ValueError, "Job is no longer active, its workload is gone");
+        return -1;
     }
-    if (!PyObject_HasAttrString(serializer, "loads")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'loads'");
-        return NULL;
+    if (PyBuffer_FillInfo(view, (PyObject*) self, data, size, 1, flags) == -1) {
+        return -1;
     }
-    if (!PyObject_HasAttrString(serializer, "dumps")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'dumps'");
+    self->exports++;
+    return 0;
+}
+
+void Job_releasebuffer(pygear_JobObject* self, Py_buffer* view) {
+    self->exports--;
+}
+
+/*
+ * Called by the worker once the job function has returned and libgearman is
+ * about to free the job. Views into the workload that are still alive keep
+ * pointing at valid memory because the job takes the buffer over first.
+ */
+void _pygear_job_detach(pygear_JobObject* self) {
+    if (self->exports > 0 && self->g_Job && !self->owned_workload) {
+        size_t taken_size;
+        self->owned_workload = gearman_job_take_workload(self->g_Job, &taken_size);
+        self->owned_workload_size = (self->owned_workload ? taken_size : 0);
+    }
+    self->g_Job = NULL;
+}
+
+/*
+ * Instance Methods
+ */
+
+static PyObject* pygear_job_set_serializer(pygear_JobObject* self, PyObject* args, PyObject* kwargs) {
+    PyObject* serializer;
+    int typed_arrays;
+    if (_pygear_parse_serializer(args, kwargs, &serializer, &typed_arrays) == -1) {
         return NULL;
     }
     Py_INCREF(serializer);
     Py_XDECREF(self->serializer);
     self->serializer = serializer;
+    self->codec = _pygear_lookup_codec(serializer);
+    self->typed_arrays = typed_arrays;
+    // Anything decoded with the previous serializer is stale now
+    Py_CLEAR(self->workload);
     Py_RETURN_NONE;
 }
 
@@ -92,19 +184,19 @@ static PyObject* pygear_job_send_data(pygear_JobObject* self, PyObject* args) {
     if (!PyArg_ParseTuple(args, "O", &data)) {
         return NULL;
     }
-    PyObject* pickled_data = PyObject_CallMethod(self->serializer, "dumps", "O", data);
-    if (!pickled_data) {
-        PyErr_SetString(PyExc_SystemError, "Could not pickle job_data data for transport\n");
+    Py_buffer pickled_data;
+    if (_pygear_serialize(self->serializer, self->codec, self->typed_arrays, data, &pickled_data) == -1) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_SystemError, "Could not pickle job_data data for transport\n");
+        }
         return NULL;
     }
-    char* c_data; Py_ssize_t c_data_size;
-    if (PyString_AsStringAndSize(pickled_data, &c_data, &c_data_size) == -1) {
-        Py_XDECREF(pickled_data);
-        PyErr_SetString(PyExc_SystemError, "Failed to convert pickled data to C string");
+    if (_pygear_compress(self->serializer, &self->compression, &pickled_data) == -1) {
+        PyBuffer_Release(&pickled_data);
         return NULL;
     }
-    Py_XDECREF(pickled_data);
-    gearman_return_t result = gearman_job_send_data(self->g_Job, c_data, c_data_size);
+    gearman_return_t result = gearman_job_send_data(self->g_Job, pickled_data.buf, pickled_data.len);
+    PyBuffer_Release(&pickled_data);
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
@@ -116,19 +208,19 @@ static PyObject* pygear_job_send_warning(pygear_JobObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, "O", &data)) {
         return NULL;
     }
-    PyObject* pickled_data = PyObject_CallMethod(self->serializer, "dumps", "O", data);
-    if (!pickled_data) {
-        PyErr_SetString(PyExc_SystemError, "Could not pickle job_warning data for transport\n");
+    Py_buffer pickled_data;
+    if (_pygear_serialize(self->serializer, self->codec, self->typed_arrays, data, &pickled_data) == -1) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_SystemError, "Could not pickle job_warning data for transport\n");
+        }
         return NULL;
     }
-    char* c_data; Py_ssize_t c_data_size;
-    if (PyString_AsStringAndSize(pickled_data, &c_data, &c_data_size) == -1) {
-        Py_XDECREF(pickled_data);
-        PyErr_SetString(PyExc_SystemError, "Failed to convert pickled warning data to C string");
+    if (_pygear_compress(self->serializer, &self->compression, &pickled_data) == -1) {
+        PyBuffer_Release(&pickled_data);
         return NULL;
     }
-    Py_XDECREF(pickled_data);
-    gearman_return_t result = gearman_job_send_warning(self->g_Job, c_data, c_data_size);
+    gearman_return_t result = gearman_job_send_warning(self->g_Job, pickled_data.buf, pickled_data.len);
+    PyBuffer_Release(&pickled_data);
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
@@ -152,19 +244,19 @@ static PyObject* pygear_job_send_complete(pygear_JobObject* self, PyObject* args
     if (!PyArg_ParseTuple(args, "O", &result)) {
         return NULL;
     }
-    PyObject* pickled_result = PyObject_CallMethod(self->serializer, "dumps", "O", result);
-    if (!pickled_result) {
-        PyErr_SetString(PyExc_SystemError, "Could not pickle job_complete data for transport\n");
+    Py_buffer pickled_result;
+    if (_pygear_serialize(self->serializer, self->codec, self->typed_arrays, result, &pickled_result) == -1) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_SystemError, "Could not pickle job_complete data for transport\n");
+        }
         return NULL;
     }
-    char* c_result; Py_ssize_t c_result_size;
-    if (PyString_AsStringAndSize(pickled_result, &c_result, &c_result_size) == -1) {
-        Py_XDECREF(pickled_result);
-        PyErr_SetString(PyExc_SystemError, "Failed to convert pickled complete data to C string");
+    if (_pygear_compress(self->serializer, &self->compression, &pickled_result) == -1) {
+        PyBuffer_Release(&pickled_result);
         return NULL;
     }
-    Py_XDECREF(pickled_result); 
-    gearman_return_t gearman_result = gearman_job_send_complete(self->g_Job, c_result, c_result_size);
+    gearman_return_t gearman_result = gearman_job_send_complete(self->g_Job, pickled_result.buf, pickled_result.len);
+    PyBuffer_Release(&pickled_result);
     if (_pygear_check_and_raise_exn(gearman_result)) {
         return NULL;
     }
@@ -176,20 +268,19 @@ static PyObject* pygear_job_send_exception(pygear_JobObject* self, PyObject* arg
     if (!PyArg_ParseTuple(args, "O", &data)) {
         return NULL;
     }
-    PyObject* pickled_data = PyObject_CallMethod(self->serializer, "dumps", "O", data);
-    if (!pickled_data) {
-        PyErr_SetString(PyExc_SystemError, "Could not pickle job_exception data for transport\n");
+    Py_buffer pickled_data;
+    if (_pygear_serialize(self->serializer, self->codec, self->typed_arrays, data, &pickled_data) == -1) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_SystemError, "Could not pickle job_exception data for transport\n");
+        }
         return NULL;
     }
-
-    char* c_data; Py_ssize_t c_data_size;
-    if (PyString_AsStringAndSize(pickled_data, &c_data, &c_data_size) == -1) {
-        Py_XDECREF(pickled_data);
-        PyErr_SetString(PyExc_SystemError, "Failed to convert pickled exception data to C string");
+    if (_pygear_compress(self->serializer, &self->compression, &pickled_data) == -1) {
+        PyBuffer_Release(&pickled_data);
         return NULL;
     }
-    Py_XDECREF(pickled_data);
-    gearman_return_t result = gearman_job_send_exception(self->g_Job, c_data, c_data_size);
+    gearman_return_t result = gearman_job_send_exception(self->g_Job, pickled_data.buf, pickled_data.len);
+    PyBuffer_Release(&pickled_data);
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
@@ -216,22 +307,40 @@ static PyObject* pygear_job_unique(pygear_JobObject* self) {
     return Py_BuildValue("s", gearman_job_unique(self->g_Job));
 }
 
-static PyObject* pygear_job_workload(pygear_JobObject* self) {
+static PyObject* pygear_job_workload(pygear_JobObject* self, PyObject* args, PyObject* kwargs) {
+    PyObject* cache = Py_True;
+    static char* kwlist[] = {"cache", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &cache)) {
+        return NULL;
+    }
+    int use_cache = PyObject_IsTrue(cache);
+    if (use_cache == -1) {
+        return NULL;
+    }
+    if (use_cache && self->workload) {
+        Py_INCREF(self->workload);
+        return self->workload;
+    }
     const char* job_workload = gearman_job_workload(self->g_Job);
     size_t job_size = gearman_job_workload_size(self->g_Job);
-    PyObject* py_result = Py_BuildValue("s#", job_workload, job_size);
-    PyObject* loadstr = PyString_FromString("loads");
-    PyObject* py_workload = PyObject_CallMethodObjArgs(
-        self->serializer,
-        loadstr,
-        py_result,
-        NULL
-    );
-    Py_XDECREF(py_result);
-    Py_XDECREF(loadstr);
+    PyObject* py_workload;
+    if (self->schema) {
+        py_workload = _pygear_deserialize(self->schema, ((pygear_CodecObject*) self->schema)->codec, 0,
+            job_workload, job_size);
+    } else {
+        py_workload = _pygear_deserialize(self->serializer, self->codec, self->typed_arrays, job_workload, job_size);
+    }
+    if (py_workload && use_cache) {
+        Py_INCREF(py_workload);
+        self->workload = py_workload;
+    }
     return py_workload;
 }
 
+static PyObject* pygear_job_workload_view(pygear_JobObject* self) {
+    return PyMemoryView_FromObject((PyObject*) self);
+}
+
 static PyObject* pygear_job_workload_size(pygear_JobObject* self) {
     return Py_BuildValue("I", gearman_job_workload_size(self->g_Job));
 }
@@ -30,6 +30,8 @@
 #include <libgearman-1.0/gearman.h>
 #include <stdio.h>
 #include "structmember.h"
+#include "serializer.h"
+#include "codec.h"
 #include "worker.h"
 
 #ifndef PyMODINIT_FUNC
@@ -39,12 +41,23 @@
 #ifndef JOB_H
 #define JOB_H
 
+/* Wrappers kept around for reuse by _pygear_job_new */
+#define PYGEAR_JOB_FREELIST_MAX 64
+
 #define _JOBMETHOD(name,flags) {#name,(PyCFunction) pygear_job_##name,flags,pygear_job_##name##_doc},
 
 typedef struct {
     PyObject_HEAD
     struct gearman_job_st* g_Job;
     PyObject* serializer;
+    pygear_codec_t* codec;      /* native codec of serializer, borrowed */
+    int typed_arrays;           /* set_serializer(typed_arrays=...) */
+    PyObject* workload;         /* decoded workload, cached by workload() */
+    PyObject* schema;           /* decodes the workload instead of serializer if set */
+    pygear_compression_t compression;   /* for data sent back by the send_* methods */
+    Py_ssize_t exports;         /* buffers handed out by workload_view */
+    char* owned_workload;       /* workload taken over from a finished job */
+    size_t owned_workload_size;
 } pygear_JobObject;
 
 PyDoc_STRVAR(job_module_docstring, "Represents a Gearman job");
@@ -55,6 +68,16 @@ int Job_traverse(pygear_JobObject *self,  visitproc visit, void *arg);
 int Job_clear(pygear_JobObject* self);
 void Job_dealloc(pygear_JobObject* self);
 
+/* Build a Job from C without going through tp_init or set_serializer */
+pygear_JobObject* _pygear_job_new(PyObject* serializer, pygear_codec_t* codec, int typed_arrays,
+    gearman_job_st* g_Job);
+
+/* Freelist counters for pygear.freelist_stats() */
+PyObject* _pygear_job_freelist_stats(void);
+int Job_getbuffer(pygear_JobObject* self, Py_buffer* view, int flags);
+void Job_releasebuffer(pygear_JobObject* self, Py_buffer* view);
+void _pygear_job_detach(pygear_JobObject* self);
+
 
 /* Method definitions */
 static PyObject* pygear_job_send_data(pygear_JobObject* self, PyObject* args);
@@ -98,9 +121,21 @@ static PyObject* pygear_job_unique(pygear_JobObject* self);
 PyDoc_STRVAR(pygear_job_unique_doc,
 "Get a pointer to the workload for a job.");
 
-static PyObject* pygear_job_workload(pygear_JobObject* self);
+static PyObject* pygear_job_workload(pygear_JobObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_job_workload_doc,
-"Get the workload for a job.");
+"Get the workload for a job, decoded by the serializer, or by the function's\n"
+"schema if it was registered with one (see Worker.add_function).\n"
+"The decoded object is cached, so later calls return the same object\n"
+"without running 'loads' again.\n"
+"@param[in] cache - Pass False to get a freshly decoded object that is not\n"
+"\tcached, e.g. when the caller is going to mutate it.");
+
+static PyObject* pygear_job_workload_view(pygear_JobObject* self);
+PyDoc_STRVAR(pygear_job_workload_view_doc,
+"Get a read-only memoryview of the raw workload, without copying or\n"
+"deserializing it. Views taken inside a worker function stay valid after it\n"
+"returns, since the job then hands its workload buffer over to them. Taking\n"
+"a new view after that raises ValueError.");
 
 static PyObject* pygear_job_workload_size(pygear_JobObject* self);
 PyDoc_STRVAR(pygear_job_workload_size_doc,
@@ -110,15 +145,18 @@ static PyObject* pygear_job_error(pygear_JobObject* self);
 PyDoc_STRVAR(pygear_job_error_doc,
 "Get a string representation of the last job error");
 
-static PyObject* pygear_job_set_serializer(pygear_JobObject* self, PyObject* args);
+static PyObject* pygear_job_set_serializer(pygear_JobObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_job_set_serializer_doc,
 "Specify the object to be used to serialize data passed through gearman.\n"
 "By default, pygear will use pickle or cPickle to convert data to a string\n"
 "representation during transit and reconstitute it on the other end.\n"
 "You can replace the serializer with your own as long as it implements\n"
 "the 'dumps' and 'loads' methods. 'dumps' must return a string, and loads\n"
-"must take a string.\n"
-"@param[in] serializer Object implementing dumps and loads");
+"must take a string. Pass None (pygear.RAW) to skip serialization and\n"
+"send and receive plain strings.\n"
+"@param[in] serializer Object implementing dumps and loads, or None\n"
+"@param[in] typed_arrays Exchange numeric arrays as raw elements; see\n"
+"\tClient.set_serializer");
 
 /* Module method specification */
 static PyMethodDef job_module_methods[] = {
@@ -131,13 +169,23 @@ static PyMethodDef job_module_methods[] = {
      _JOBMETHOD(handle,             METH_NOARGS)
      _JOBMETHOD(function_name,      METH_NOARGS)
      _JOBMETHOD(unique,             METH_NOARGS)
-     _JOBMETHOD(workload,           METH_NOARGS)
+     _JOBMETHOD(workload,           METH_VARARGS | METH_KEYWORDS)
+     _JOBMETHOD(workload_view,      METH_NOARGS)
      _JOBMETHOD(workload_size,      METH_NOARGS)
      _JOBMETHOD(error,              METH_NOARGS)
-     _JOBMETHOD(set_serializer,     METH_VARARGS)
+     _JOBMETHOD(set_serializer,     METH_VARARGS | METH_KEYWORDS)
     {NULL, NULL, 0, NULL}
 };
 
+static PyBufferProcs job_as_buffer = {
+    0,                                          /* bf_getreadbuffer */
+    0,                                          /* bf_getwritebuffer */
+    0,                                          /* bf_getsegcount */
+    0,                                          /* bf_getcharbuffer */
+    (getbufferproc)Job_getbuffer,               /* bf_getbuffer */
+    (releasebufferproc)Job_releasebuffer,       /* bf_releasebuffer */
+};
+
 PyTypeObject pygear_JobType = {
     PyObject_HEAD_INIT(NULL)
     0,                                          /*ob_size*/
@@ -158,10 +206,11 @@ PyTypeObject pygear_JobType = {
     0,                                          /*tp_str*/
     0,                                          /*tp_getattro*/
     0,                                          /*tp_setattro*/
-    0,                                          /*tp_as_buffer*/
+    &job_as_buffer,                             /*tp_as_buffer*/
     Py_TPFLAGS_DEFAULT |
     Py_TPFLAGS_BASETYPE |
-    Py_TPFLAGS_HAVE_GC,                         /*tp_flags*/
+    Py_TPFLAGS_HAVE_GC |
+    Py_TPFLAGS_HAVE_NEWBUFFER,                  /*tp_flags*/
     job_module_docstring,                       /* tp_doc */
     (traverseproc)Job_traverse,                 /* tp_traverse */
     (inquiry)Job_clear,                         /* tp_clear */
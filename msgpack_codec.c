@@ -0,0 +1,437 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "msgpack_codec.h"
+
+/*
+ * Encoding
+ */
+
+static int _pygear_msgpack_reserve(pygear_msgpack_writer* writer, Py_ssize_t size) {
+    Py_ssize_t allocated = PyString_GET_SIZE(writer->str);
+    if (writer->len + size <= allocated) {
+        return 0;
+    }
+    Py_ssize_t new_size = allocated * 2;
+    if (new_size < writer->len + size) {
+        new_size = writer->len + size;
+    }
+    return _PyString_Resize(&writer->str, new_size);
+}
+
+static int _pygear_msgpack_write(pygear_msgpack_writer* writer, const void* data, Py_ssize_t size) {
+    if (_pygear_msgpack_reserve(writer, size) == -1) {
+        return -1;
+    }
+    memcpy(PyString_AS_STRING(writer->str) + writer->len, data, size);
+    writer->len += size;
+    return 0;
+}
+
+/* Write a type byte followed by value as an nbytes big-endian integer */
+static int _pygear_msgpack_write_tagged(pygear_msgpack_writer* writer, unsigned char tag,
+    uint64_t value, int nbytes) {
+
+    unsigned char buf[9];
+    int i;
+    buf[0] = tag;
+    for (i = nbytes; i > 0; --i) {
+        buf[i] = (unsigned char) (value & 0xff);
+        value >>= 8;
+    }
+    return _pygear_msgpack_write(writer, buf, nbytes + 1);
+}
+
+static int _pygear_msgpack_write_uint(pygear_msgpack_writer* writer, uint64_t value) {
+    if (value < 0x80) {
+        return _pygear_msgpack_write_tagged(writer, (unsigned char) value, 0, 0);
+    } else if (value <= 0xff) {
+        return _pygear_msgpack_write_tagged(writer, 0xcc, value, 1);
+    } else if (value <= 0xffff) {
+        return _pygear_msgpack_write_tagged(writer, 0xcd, value, 2);
+    } else if (value <= 0xffffffffULL) {
+        return _pygear_msgpack_write_tagged(writer, 0xce, value, 4);
+    }
+    return _pygear_msgpack_write_tagged(writer, 0xcf, value, 8);
+}
+
+static int _pygear_msgpack_write_int(pygear_msgpack_writer* writer, int64_t value) {
+    if (value >= 0) {
+        return _pygear_msgpack_write_uint(writer, (uint64_t) value);
+    } else if (value >= -32) {
+        return _pygear_msgpack_write_tagged(writer, (unsigned char) (value & 0xff), 0, 0);
+    } else if (value >= -128) {
+        return _pygear_msgpack_write_tagged(writer, 0xd0, (uint64_t) value, 1);
+    } else if (value >= -32768) {
+        return _pygear_msgpack_write_tagged(writer, 0xd1, (uint64_t) value, 2);
+    } else if (value >= -2147483648LL) {
+        return _pygear_msgpack_write_tagged(writer, 0xd2, (uint64_t) value, 4);
+    }
+    return _pygear_msgpack_write_tagged(writer, 0xd3, (uint64_t) value, 8);
+}
+
+/* Write a length header picking the smallest of the fix/8/16/32 forms; fix_max
+ * is 0 for types without a fix form and tag8 is 0 for types without an 8-bit one */
+static int _pygear_msgpack_write_length(pygear_msgpack_writer* writer, Py_ssize_t length,
+    unsigned char fix_tag, Py_ssize_t fix_max, unsigned char tag8, unsigned char tag16, unsigned char tag32) {
+
+    if (length < fix_max) {
+        return _pygear_msgpack_write_tagged(writer, fix_tag | (unsigned char) length, 0, 0);
+    } else if (tag8 && length <= 0xff) {
+        return _pygear_msgpack_write_tagged(writer, tag8, length, 1);
+    } else if (length <= 0xffff) {
+        return _pygear_msgpack_write_tagged(writer, tag16, length, 2);
+    } else if ((uint64_t) length <= 0xffffffffULL) {
+        return _pygear_msgpack_write_tagged(writer, tag32, length, 4);
+    }
+    PyErr_SetString(PyExc_ValueError, "object too large for msgpack");
+    return -1;
+}
+
+static int _pygear_msgpack_write_bin(pygear_msgpack_writer* writer, const void* data, Py_ssize_t size) {
+    if (_pygear_msgpack_write_length(writer, size, 0, 0, 0xc4, 0xc5, 0xc6) == -1) {
+        return -1;
+    }
+    return _pygear_msgpack_write(writer, data, size);
+}
+
+static int _pygear_msgpack_pack(pygear_msgpack_writer* writer, PyObject* obj);
+
+static int _pygear_msgpack_pack_container(pygear_msgpack_writer* writer, PyObject* obj) {
+    Py_ssize_t i, size;
+    if (PyList_Check(obj) || PyTuple_Check(obj)) {
+        size = PySequence_Fast_GET_SIZE(obj);
+        PyObject** items = PySequence_Fast_ITEMS(obj);
+        if (_pygear_msgpack_write_length(writer, size, 0x90, 16, 0, 0xdc, 0xdd) == -1) {
+            return -1;
+        }
+        for (i = 0; i < size; ++i) {
+            if (_pygear_msgpack_pack(writer, items[i]) == -1) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    if (_pygear_msgpack_write_length(writer, PyDict_Size(obj), 0x80, 16, 0, 0xde, 0xdf) == -1) {
+        return -1;
+    }
+    while (PyDict_Next(obj, &pos, &key, &value)) {
+        if (_pygear_msgpack_pack(writer, key) == -1 || _pygear_msgpack_pack(writer, value) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int _pygear_msgpack_pack(pygear_msgpack_writer* writer, PyObject* obj) {
+    if (obj == Py_None) {
+        return _pygear_msgpack_write_tagged(writer, 0xc0, 0, 0);
+    } else if (PyBool_Check(obj)) {
+        return _pygear_msgpack_write_tagged(writer, (obj == Py_True ? 0xc3 : 0xc2), 0, 0);
+    } else if (PyInt_Check(obj)) {
+        return _pygear_msgpack_write_int(writer, PyInt_AS_LONG(obj));
+    } else if (PyLong_Check(obj)) {
+        int overflow;
+        PY_LONG_LONG value = PyLong_AsLongLongAndOverflow(obj, &overflow);
+        if (overflow > 0) {
+            unsigned PY_LONG_LONG uvalue = PyLong_AsUnsignedLongLong(obj);
+            if (uvalue == (unsigned PY_LONG_LONG) -1 && PyErr_Occurred()) {
+                return -1;
+            }
+            return _pygear_msgpack_write_uint(writer, uvalue);
+        } else if (overflow < 0) {
+            PyErr_SetString(PyExc_OverflowError, "int too small to convert to msgpack");
+            return -1;
+        } else if (value == -1 && PyErr_Occurred()) {
+            return -1;
+        }
+        return _pygear_msgpack_write_int(writer, value);
+    } else if (PyFloat_Check(obj)) {
+        unsigned char buf[9];
+        buf[0] = 0xcb;
+        if (_PyFloat_Pack8(PyFloat_AS_DOUBLE(obj), buf + 1, 0) == -1) {
+            return -1;
+        }
+        return _pygear_msgpack_write(writer, buf, 9);
+    } else if (PyString_Check(obj)) {
+        return _pygear_msgpack_write_bin(writer, PyString_AS_STRING(obj), PyString_GET_SIZE(obj));
+    } else if (PyByteArray_Check(obj)) {
+        return _pygear_msgpack_write_bin(writer, PyByteArray_AS_STRING(obj), PyByteArray_GET_SIZE(obj));
+    } else if (PyUnicode_Check(obj)) {
+        PyObject* utf8 = PyUnicode_AsUTF8String(obj);
+        if (!utf8) {
+            return -1;
+        }
+        Py_ssize_t size = PyString_GET_SIZE(utf8);
+        int ret = _pygear_msgpack_write_length(writer, size, 0xa0, 32, 0xd9, 0xda, 0xdb);
+        if (ret == 0) {
+            ret = _pygear_msgpack_write(writer, PyString_AS_STRING(utf8), size);
+        }
+        Py_DECREF(utf8);
+        return ret;
+    } else if (PyList_Check(obj) || PyTuple_Check(obj) || PyDict_Check(obj)) {
+        if (Py_EnterRecursiveCall(" while encoding msgpack")) {
+            return -1;
+        }
+        int ret = _pygear_msgpack_pack_container(writer, obj);
+        Py_LeaveRecursiveCall();
+        return ret;
+    }
+    PyErr_Format(PyExc_TypeError, "%.200s is not msgpack serializable", Py_TYPE(obj)->tp_name);
+    return -1;
+}
+
+static PyObject* _pygear_msgpack_encode(void* state, PyObject* obj) {
+    pygear_msgpack_writer writer;
+    writer.len = 0;
+    writer.str = PyString_FromStringAndSize(NULL, PYGEAR_MSGPACK_INITIAL_SIZE);
+    if (!writer.str) {
+        return NULL;
+    }
+    if (_pygear_msgpack_pack(&writer, obj) == -1) {
+        Py_XDECREF(writer.str);
+        return NULL;
+    }
+    if (_PyString_Resize(&writer.str, writer.len) == -1) {
+        return NULL;
+    }
+    return writer.str;
+}
+
+/*
+ * Decoding
+ */
+
+static int _pygear_msgpack_need(pygear_msgpack_reader* reader, Py_ssize_t size) {
+    if (size < 0 || reader->end - reader->pos < size) {
+        PyErr_SetString(PyExc_ValueError, "truncated msgpack payload");
+        return -1;
+    }
+    return 0;
+}
+
+/* Read an nbytes big-endian unsigned integer; the caller checked the length */
+static uint64_t _pygear_msgpack_read_be(pygear_msgpack_reader* reader, int nbytes) {
+    uint64_t value = 0;
+    int i;
+    for (i = 0; i < nbytes; ++i) {
+        value = (value << 8) | reader->pos[i];
+    }
+    reader->pos += nbytes;
+    return value;
+}
+
+static PyObject* _pygear_msgpack_int(PY_LONG_LONG value) {
+    if (value >= LONG_MIN && value <= LONG_MAX) {
+        return PyInt_FromLong((long) value);
+    }
+    return PyLong_FromLongLong(value);
+}
+
+static PyObject* _pygear_msgpack_uint(unsigned PY_LONG_LONG value) {
+    if (value <= LONG_MAX) {
+        return PyInt_FromLong((long) value);
+    }
+    return PyLong_FromUnsignedLongLong(value);
+}
+
+static PyObject* _pygear_msgpack_unpack(pygear_msgpack_reader* reader);
+
+static PyObject* _pygear_msgpack_unpack_array(pygear_msgpack_reader* reader, Py_ssize_t size) {
+    // Every element takes at least one byte, which bounds the allocation
+    if (_pygear_msgpack_need(reader, size) == -1) {
+        return NULL;
+    }
+    PyObject* list = PyList_New(size);
+    Py_ssize_t i;
+    if (!list) {
+        return NULL;
+    }
+    for (i = 0; i < size; ++i) {
+        PyObject* item = _pygear_msgpack_unpack(reader);
+        if (!item) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    return list;
+}
+
+static PyObject* _pygear_msgpack_unpack_map(pygear_msgpack_reader* reader, Py_ssize_t size) {
+    if (_pygear_msgpack_need(reader, size * 2) == -1) {
+        return NULL;
+    }
+    PyObject* dict = PyDict_New();
+    Py_ssize_t i;
+    if (!dict) {
+        return NULL;
+    }
+    for (i = 0; i < size; ++i) {
+        PyObject* key = _pygear_msgpack_unpack(reader);
+        PyObject* value = (key ? _pygear_msgpack_unpack(reader) : NULL);
+        if (!value || PyDict_SetItem(dict, key, value) == -1) {
+            Py_XDECREF(key);
+            Py_XDECREF(value);
+            Py_DECREF(dict);
+            return NULL;
+        }
+        Py_DECREF(key);
+        Py_DECREF(value);
+    }
+    return dict;
+}
+
+static PyObject* _pygear_msgpack_unpack_bytes(pygear_msgpack_reader* reader, Py_ssize_t size, int is_text) {
+    if (_pygear_msgpack_need(reader, size) == -1) {
+        return NULL;
+    }
+    const char* data = (const char*) reader->pos;
+    reader->pos += size;
+    if (is_text) {
+        return PyUnicode_DecodeUTF8(data, size, "strict");
+    }
+    return PyString_FromStringAndSize(data, size);
+}
+
+/* Read the length that follows a type byte, as an nbytes big-endian integer */
+static Py_ssize_t _pygear_msgpack_read_length(pygear_msgpack_reader* reader, int nbytes) {
+    if (_pygear_msgpack_need(reader, nbytes) == -1) {
+        return -1;
+    }
+    uint64_t length = _pygear_msgpack_read_be(reader, nbytes);
+    if (length > (uint64_t) PY_SSIZE_T_MAX) {
+        PyErr_SetString(PyExc_ValueError, "msgpack length out of range");
+        return -1;
+    }
+    return (Py_ssize_t) length;
+}
+
+static PyObject* _pygear_msgpack_unpack_value(pygear_msgpack_reader* reader) {
+    unsigned char tag = *reader->pos++;
+    Py_ssize_t length;
+
+    if (tag <= 0x7f) {
+        return PyInt_FromLong(tag);
+    } else if (tag >= 0xe0) {
+        return PyInt_FromLong((signed char) tag);
+    } else if ((tag & 0xf0) == 0x80) {
+        return _pygear_msgpack_unpack_map(reader, tag & 0x0f);
+    } else if ((tag & 0xf0) == 0x90) {
+        return _pygear_msgpack_unpack_array(reader, tag & 0x0f);
+    } else if ((tag & 0xe0) == 0xa0) {
+        return _pygear_msgpack_unpack_bytes(reader, tag & 0x1f, 1);
+    }
+
+    switch (tag) {
+        case 0xc0:
+            Py_RETURN_NONE;
+        case 0xc2:
+            Py_RETURN_FALSE;
+        case 0xc3:
+            Py_RETURN_TRUE;
+        case 0xc4: case 0xc5: case 0xc6:
+            length = _pygear_msgpack_read_length(reader, 1 << (tag - 0xc4));
+            return (length < 0 ? NULL : _pygear_msgpack_unpack_bytes(reader, length, 0));
+        case 0xca:
+            if (_pygear_msgpack_need(reader, 4) == -1) {
+                return NULL;
+            }
+            reader->pos += 4;
+            return PyFloat_FromDouble(_PyFloat_Unpack4(reader->pos - 4, 0));
+        case 0xcb:
+            if (_pygear_msgpack_need(reader, 8) == -1) {
+                return NULL;
+            }
+            reader->pos += 8;
+            return PyFloat_FromDouble(_PyFloat_Unpack8(reader->pos - 8, 0));
+        case 0xcc: case 0xcd: case 0xce: case 0xcf: {
+            int nbytes = 1 << (tag - 0xcc);
+            if (_pygear_msgpack_need(reader, nbytes) == -1) {
+                return NULL;
+            }
+            return _pygear_msgpack_uint(_pygear_msgpack_read_be(reader, nbytes));
+        }
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+            int nbytes = 1 << (tag - 0xd0);
+            if (_pygear_msgpack_need(reader, nbytes) == -1) {
+                return NULL;
+            }
+            uint64_t value = _pygear_msgpack_read_be(reader, nbytes);
+            // Sign-extend from nbytes * 8 bits
+            if (nbytes < 8 && (value & (1ULL << (nbytes * 8 - 1)))) {
+                value |= ~0ULL << (nbytes * 8);
+            }
+            return _pygear_msgpack_int((PY_LONG_LONG) value);
+        }
+        case 0xd9: case 0xda: case 0xdb:
+            length = _pygear_msgpack_read_length(reader, 1 << (tag - 0xd9));
+            return (length < 0 ? NULL : _pygear_msgpack_unpack_bytes(reader, length, 1));
+        case 0xdc: case 0xdd:
+            length = _pygear_msgpack_read_length(reader, (tag == 0xdc ? 2 : 4));
+            return (length < 0 ? NULL : _pygear_msgpack_unpack_array(reader, length));
+        case 0xde: case 0xdf:
+            length = _pygear_msgpack_read_length(reader, (tag == 0xde ? 2 : 4));
+            return (length < 0 ? NULL : _pygear_msgpack_unpack_map(reader, length));
+    }
+    PyErr_Format(PyExc_ValueError, "unsupported msgpack type 0x%02x", tag);
+    return NULL;
+}
+
+static PyObject* _pygear_msgpack_unpack(pygear_msgpack_reader* reader) {
+    if (_pygear_msgpack_need(reader, 1) == -1) {
+        return NULL;
+    }
+    if (Py_EnterRecursiveCall(" while decoding msgpack")) {
+        return NULL;
+    }
+    PyObject* ret = _pygear_msgpack_unpack_value(reader);
+    Py_LeaveRecursiveCall();
+    return ret;
+}
+
+static PyObject* _pygear_msgpack_decode(void* state, const char* data, Py_ssize_t size) {
+    pygear_msgpack_reader reader;
+    reader.pos = (const unsigned char*) data;
+    reader.end = reader.pos + size;
+    PyObject* ret = _pygear_msgpack_unpack(&reader);
+    if (ret && reader.pos != reader.end) {
+        Py_DECREF(ret);
+        PyErr_SetString(PyExc_ValueError, "extra data after msgpack payload");
+        return NULL;
+    }
+    return ret;
+}
+
+pygear_codec_t pygear_msgpack_codec = {
+    _pygear_msgpack_encode,
+    _pygear_msgpack_decode,
+    NULL
+};
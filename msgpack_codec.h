@@ -0,0 +1,60 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include <stdint.h>
+#include "serializer.h"
+
+#ifndef MSGPACK_CODEC_H
+#define MSGPACK_CODEC_H
+
+/*
+ * msgpack codec, exported as pygear.MSGPACK.
+ *
+ * Python str (and bytearray) is packed as msgpack bin and comes back as
+ * str; unicode is packed as msgpack str (UTF-8) and comes back as unicode.
+ * Tuples come back as lists. Other types raise TypeError.
+ */
+
+/* Growing output buffer used while encoding */
+typedef struct {
+    PyObject* str;
+    Py_ssize_t len;
+} pygear_msgpack_writer;
+
+/* Input cursor used while decoding */
+typedef struct {
+    const unsigned char* pos;
+    const unsigned char* end;
+} pygear_msgpack_reader;
+
+#define PYGEAR_MSGPACK_INITIAL_SIZE 64
+
+extern pygear_codec_t pygear_msgpack_codec;
+
+#endif
@@ -27,6 +27,8 @@
  */
 
 #include "pygear.h"
+#include <errno.h>
+#include <poll.h>
 
 #define INIT_EXN(EXN) \
 PyGearExn_##EXN = PyErr_NewException("pygear." # EXN, NULL, NULL); \
@@ -36,6 +38,10 @@ PyModule_AddObject(m, #EXN, PyGearExn_##EXN);
 PyMODINIT_FUNC initpygear(void) {
     PyObject* m;
 
+    // Blocking libgearman calls release the GIL, and the callbacks they run
+    // take it back with PyGILState_Ensure, so the GIL must exist up front
+    PyEval_InitThreads();
+
     pygear_ClientType.tp_new = PyType_GenericNew;
     if (PyType_Ready(&pygear_ClientType) < 0) {
         return;
@@ -46,6 +52,26 @@ PyMODINIT_FUNC initpygear(void) {
         return;
     }
 
+    if (PyType_Ready(&pygear_FutureType) < 0) {
+        return;
+    }
+
+    if (PyType_Ready(&pygear_FutureIteratorType) < 0) {
+        return;
+    }
+
+    if (PyType_Ready(&pygear_CodecType) < 0) {
+        return;
+    }
+
+    if (PyType_Ready(&pygear_SchemaType) < 0) {
+        return;
+    }
+
+    if (PyType_Ready(&pygear_ResultType) < 0) {
+        return;
+    }
+
     pygear_JobType.tp_new = PyType_GenericNew;
     if (PyType_Ready(&pygear_JobType) < 0) {
         return;
@@ -56,6 +82,11 @@ PyMODINIT_FUNC initpygear(void) {
         return;
     }
 
+    pygear_WorkerPoolType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pygear_WorkerPoolType) < 0) {
+        return;
+    }
+
     if (PyType_Ready(&pygear_AdminType) < 0) {
         return;
     }
@@ -71,6 +102,13 @@ PyMODINIT_FUNC initpygear(void) {
     Py_INCREF(&pygear_TaskType);
     PyModule_AddObject(m, "Task", (PyObject *)&pygear_TaskType);
 
+    Py_INCREF(&pygear_FutureType);
+    PyModule_AddObject(m, "Future", (PyObject *)&pygear_FutureType);
+
+    // Add Result class
+    Py_INCREF(&pygear_ResultType);
+    PyModule_AddObject(m, "Result", (PyObject *)&pygear_ResultType);
+
     // Add Job class
     Py_INCREF(&pygear_JobType);
     PyModule_AddObject(m, "Job", (PyObject *)&pygear_JobType);
@@ -79,10 +117,25 @@ PyMODINIT_FUNC initpygear(void) {
     Py_INCREF(&pygear_WorkerType);
     PyModule_AddObject(m, "Worker", (PyObject *)&pygear_WorkerType);
 
+    // Add WorkerPool class
+    Py_INCREF(&pygear_WorkerPoolType);
+    PyModule_AddObject(m, "WorkerPool", (PyObject *)&pygear_WorkerPoolType);
+
     // Add Admin class
     Py_INCREF(&pygear_AdminType);
     PyModule_AddObject(m, "Admin", (PyObject *)&pygear_AdminType);
 
+    // Passing RAW to set_serializer sends payloads through as plain strings
+    Py_INCREF(Py_None);
+    PyModule_AddObject(m, "RAW", Py_None);
+
+    // Add Codec class and the built-in native codecs
+    Py_INCREF(&pygear_CodecType);
+    PyModule_AddObject(m, "Codec", (PyObject *)&pygear_CodecType);
+    PyModule_AddObject(m, "MSGPACK", _pygear_codec_object_new(&pygear_CodecType, &pygear_msgpack_codec));
+    Py_INCREF(&pygear_SchemaType);
+    PyModule_AddObject(m, "Schema", (PyObject *)&pygear_SchemaType);
+
     // Enum replacements
     PyModule_AddIntConstant(m, "PYGEAR_VERBOSE_NEVER", GEARMAN_VERBOSE_NEVER);
     PyModule_AddIntConstant(m, "PYGEAR_VERBOSE_FATAL", GEARMAN_VERBOSE_FATAL);
@@ -92,6 +145,10 @@ PyMODINIT_FUNC initpygear(void) {
     PyModule_AddIntConstant(m, "PYGEAR_VERBOSE_CRAZY", GEARMAN_VERBOSE_CRAZY);
     PyModule_AddIntConstant(m, "PYGEAR_VERBOSE_MAX",   GEARMAN_VERBOSE_MAX);
 
+    PyModule_AddIntConstant(m, "PYGEAR_PRIORITY_HIGH",   GEARMAN_JOB_PRIORITY_HIGH);
+    PyModule_AddIntConstant(m, "PYGEAR_PRIORITY_NORMAL", GEARMAN_JOB_PRIORITY_NORMAL);
+    PyModule_AddIntConstant(m, "PYGEAR_PRIORITY_LOW",    GEARMAN_JOB_PRIORITY_LOW);
+
     // Exception init
     INIT_EXN(ERROR);
     INIT_EXN(SHUTDOWN);
@@ -280,3 +337,110 @@ static PyObject* pygear_describe_returncode(void* self, PyObject* args) {
 
     return Py_BuildValue("s", ret_code_desc);
 }
+
+static PyObject* pygear_set_wait_hook(void* self, PyObject* args) {
+    PyObject* hook;
+    if (!PyArg_ParseTuple(args, "O", &hook)) {
+        return NULL;
+    }
+    if (hook != Py_None && !PyCallable_Check(hook)) {
+        PyErr_SetString(PyExc_TypeError, "wait hook must be callable or None");
+        return NULL;
+    }
+    Py_XDECREF(_pygear_wait_hook);
+    _pygear_wait_hook = NULL;
+    if (hook != Py_None) {
+        Py_INCREF(hook);
+        _pygear_wait_hook = hook;
+    }
+    Py_RETURN_NONE;
+}
+
+/* Return value: New reference */
+static PyObject* pygear_poll(void* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"objects", "timeout", NULL};
+    PyObject* py_objects;
+    PyObject* timeout = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &py_objects, &timeout)) {
+        return NULL;
+    }
+    double deadline;
+    if (_pygear_future_deadline(timeout, &deadline) == -1) {
+        return NULL;
+    }
+    PyObject* objects = PySequence_Fast(py_objects, "objects must be an iterable of Clients and Workers");
+    if (!objects) {
+        return NULL;
+    }
+    Py_ssize_t num_objects = PySequence_Fast_GET_SIZE(objects);
+    PyObject* ready = NULL;
+    struct pollfd* fds = PyMem_New(struct pollfd, num_objects ? num_objects : 1);
+    if (!fds) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    Py_ssize_t i;
+    for (i = 0; i < num_objects; ++i) {
+        PyObject* object = PySequence_Fast_GET_ITEM(objects, i);
+        pygear_waiter_t* waiter;
+        if (PyObject_TypeCheck(object, &pygear_ClientType)) {
+            waiter = &((pygear_ClientObject*) object)->waiter;
+        } else if (PyObject_TypeCheck(object, &pygear_WorkerType)) {
+            waiter = &((pygear_WorkerObject*) object)->waiter;
+        } else {
+            PyErr_SetString(PyExc_TypeError, "objects must be an iterable of Clients and Workers");
+            goto done;
+        }
+        fds[i].fd = _pygear_waiter_fileno(waiter);
+        if (fds[i].fd == -1) {
+            goto done;
+        }
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    int result;
+    while (1) {
+        int poll_timeout = -1;
+        if (deadline >= 0) {
+            double remaining = deadline - _pygear_future_now();
+            poll_timeout = (remaining > 0 ? (int) (remaining * 1000 + 0.5) : 0);
+        }
+        Py_BEGIN_ALLOW_THREADS
+        result = poll(fds, num_objects, poll_timeout);
+        Py_END_ALLOW_THREADS
+        if (result != -1) {
+            break;
+        }
+        if (errno != EINTR) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            goto done;
+        }
+        if (PyErr_CheckSignals()) {
+            goto done;
+        }
+    }
+    ready = PyList_New(0);
+    for (i = 0; ready && i < num_objects; ++i) {
+        if (fds[i].revents && PyList_Append(ready, PySequence_Fast_GET_ITEM(objects, i)) == -1) {
+            Py_CLEAR(ready);
+        }
+    }
+
+done:
+    PyMem_Del(fds);
+    Py_DECREF(objects);
+    return ready;
+}
+
+/* Return value: New reference */
+static PyObject* pygear_freelist_stats(void* self) {
+    PyObject* task_stats = _pygear_task_freelist_stats();
+    PyObject* job_stats = _pygear_job_freelist_stats();
+    PyObject* ret = NULL;
+    if (task_stats && job_stats) {
+        ret = Py_BuildValue("{s:O, s:O}", "task", task_stats, "job", job_stats);
+    }
+    Py_XDECREF(task_stats);
+    Py_XDECREF(job_stats);
+    return ret;
+}
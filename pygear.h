@@ -33,10 +33,18 @@
 
 #include <Python.h>
 #include <libgearman-1.0/gearman.h>
+#include "serializer.c"
+#include "waiter.c"
+#include "codec.c"
+#include "msgpack_codec.c"
+#include "schema.c"
+#include "result.c"
 #include "client.c"
 #include "task.c"
+#include "future.c"
 #include "job.c"
 #include "worker.c"
+#include "workerpool.c"
 #include "exception.h"
 #include "admin.c"
 
@@ -52,10 +60,47 @@ PyDoc_STRVAR(pygear_describe_returncode_doc,
 "the result.\n"
 "@param[in] code Error code number to describe");
 
+static PyObject* pygear_freelist_stats(void* self);
+PyDoc_STRVAR(pygear_freelist_stats_doc,
+"Report on the freelists that recycle the Task and Job objects handed to\n"
+"client callbacks and worker functions.\n"
+"@return dict with a 'task' and a 'job' entry, each holding the current\n"
+"'size', the 'max' size and the number of allocations 'reused' from it.");
+
+
+static PyObject* pygear_set_wait_hook(void* self, PyObject* args);
+PyDoc_STRVAR(pygear_set_wait_hook_doc,
+"Make blocking calls cooperate with a green thread library such as gevent.\n"
+"While a hook is set, Client.do*, Client.run_tasks, Future.result,\n"
+"Client.as_completed and Worker.work run libgearman in non-blocking mode\n"
+"and call hook(fd, timeout) instead of blocking, where fd is the object's\n"
+"fileno() and timeout is in seconds or None. The hook must return once fd\n"
+"is readable or the timeout has passed, switching to other green threads\n"
+"meanwhile. Each Client or Worker must only be used by one green thread\n"
+"at a time.\n\n"
+"@param[in] hook - Callable, or None to block normally again.\n\n"
+"Example:\n"
+"pygear.set_wait_hook(lambda fd, timeout: gevent.select.select([fd], [], [], timeout))");
+
+
+static PyObject* pygear_poll(void* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_poll_doc,
+"Wait until any of several Clients and Workers can make progress, so that\n"
+"one thread can serve them all without polling each with a short timeout.\n"
+"This waits on each object's fileno(); call step() on an object once to\n"
+"start it, then step() it whenever poll reports it.\n\n"
+"@param[in] objects - Iterable of Clients and Workers.\n"
+"@param[in] timeout - Seconds to wait at most, or None to wait until one is ready.\n"
+"@returns List of the objects that are ready, in the order they were given.\n"
+"    Empty if the timeout passed first.");
+
 
 /* Module method specification */
 static PyMethodDef pygear_class_methods[] = {
     {"describe_returncode", (PyCFunction) pygear_describe_returncode, METH_VARARGS, pygear_describe_returncode_doc},
+    {"freelist_stats", (PyCFunction) pygear_freelist_stats, METH_NOARGS, pygear_freelist_stats_doc},
+    {"set_wait_hook", (PyCFunction) pygear_set_wait_hook, METH_VARARGS, pygear_set_wait_hook_doc},
+    {"poll", (PyCFunction) pygear_poll, METH_VARARGS|METH_KEYWORDS, pygear_poll_doc},
     {NULL, NULL, 0, NULL}
 };
 
@@ -0,0 +1,158 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "result.h"
+
+/*
+ * Class constructor / destructor methods
+ */
+
+PyObject* _pygear_result_new(void* data, size_t size) {
+    pygear_ResultObject* self = PyObject_New(pygear_ResultObject, &pygear_ResultType);
+    if (!self) {
+        free(data);
+        return NULL;
+    }
+    self->data = (char*) data;
+    self->size = (data ? size : 0);
+    self->hash = -1;
+    return (PyObject*) self;
+}
+
+void Result_dealloc(pygear_ResultObject* self) {
+    free(self->data);
+    self->data = NULL;
+    PyObject_Del(self);
+}
+
+/*
+ * Protocol methods
+ */
+
+PyObject* Result_str(pygear_ResultObject* self) {
+    return PyString_FromStringAndSize(self->data, self->size);
+}
+
+PyObject* Result_repr(pygear_ResultObject* self) {
+    PyObject* as_string = Result_str(self);
+    if (!as_string) {
+        return NULL;
+    }
+    PyObject* string_repr = PyObject_Repr(as_string);
+    Py_DECREF(as_string);
+    if (!string_repr) {
+        return NULL;
+    }
+    PyObject* ret = PyString_FromFormat("pygear.Result(%s)", PyString_AS_STRING(string_repr));
+    Py_DECREF(string_repr);
+    return ret;
+}
+
+Py_ssize_t Result_length(pygear_ResultObject* self) {
+    return self->size;
+}
+
+PyObject* Result_richcompare(pygear_ResultObject* self, PyObject* other, int op) {
+    Py_buffer other_view;
+    if (PyUnicode_Check(other) || _pygear_get_buffer(other, &other_view) == -1) {
+        PyErr_Clear();
+        Py_INCREF(Py_NotImplemented);
+        return Py_NotImplemented;
+    }
+    Py_ssize_t min_size = (self->size < other_view.len ? self->size : other_view.len);
+    int cmp = (min_size ? memcmp(self->data, other_view.buf, min_size) : 0);
+    if (cmp == 0) {
+        cmp = (self->size < other_view.len ? -1 : (self->size > other_view.len ? 1 : 0));
+    }
+    PyBuffer_Release(&other_view);
+    int truth;
+    switch (op) {
+        case Py_LT: truth = cmp < 0; break;
+        case Py_LE: truth = cmp <= 0; break;
+        case Py_EQ: truth = cmp == 0; break;
+        case Py_NE: truth = cmp != 0; break;
+        case Py_GT: truth = cmp > 0; break;
+        default:    truth = cmp >= 0; break;
+    }
+    PyObject* ret = (truth ? Py_True : Py_False);
+    Py_INCREF(ret);
+    return ret;
+}
+
+long Result_hash(pygear_ResultObject* self) {
+    // Same as string_hash, since a Result compares equal to the same str
+    if (self->hash != -1) {
+        return self->hash;
+    }
+    if (self->size == 0) {
+        self->hash = 0;
+        return 0;
+    }
+    const unsigned char* p = (const unsigned char*) self->data;
+    Py_ssize_t len = self->size;
+    long x = _Py_HashSecret.prefix;
+    x ^= *p << 7;
+    while (--len >= 0) {
+        x = (1000003 * x) ^ *p++;
+    }
+    x ^= self->size;
+    x ^= _Py_HashSecret.suffix;
+    if (x == -1) {
+        x = -2;
+    }
+    self->hash = x;
+    return x;
+}
+
+int Result_getbuffer(pygear_ResultObject* self, Py_buffer* view, int flags) {
+    return PyBuffer_FillInfo(view, (PyObject*) self, self->data, self->size, 1, flags);
+}
+
+Py_ssize_t Result_getreadbuffer(pygear_ResultObject* self, Py_ssize_t segment, void** ptr) {
+    if (segment != 0) {
+        PyErr_SetString(PyExc_SystemError, "accessing non-existent Result segment");
+        return -1;
+    }
+    *ptr = self->data;
+    return self->size;
+}
+
+Py_ssize_t Result_getsegcount(pygear_ResultObject* self, Py_ssize_t* lenp) {
+    if (lenp) {
+        *lenp = self->size;
+    }
+    return 1;
+}
+
+/*
+ * Instance Methods
+ */
+
+static PyObject* pygear_result_tobytes(pygear_ResultObject* self) {
+    return Result_str(self);
+}
@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include <stdio.h>
+#include "structmember.h"
+#include "serializer.h"
+
+#ifndef PyMODINIT_FUNC
+#define PyMODINIT_FUNC void
+#endif
+
+#ifndef RESULT_H
+#define RESULT_H
+
+#define _RESULTMETHOD(name,flags) {#name,(PyCFunction) pygear_result_##name,flags,pygear_result_##name##_doc},
+
+typedef struct {
+    PyObject_HEAD
+    char* data;         /* malloc'd by libgearman, owned by this object */
+    Py_ssize_t size;
+    long hash;          /* -1 until computed */
+} pygear_ResultObject;
+
+PyDoc_STRVAR(result_module_docstring,
+"Read-only bytes returned by a task in RAW mode.\n"
+"The object owns the buffer libgearman allocated for the result, so no copy\n"
+"is made. It supports the buffer protocol (memoryview, file.write, ...),\n"
+"len(), comparison with str and hashing like the equal str. Use str() to get\n"
+"a copy as a string.");
+
+/* Class init methods */
+PyObject* _pygear_result_new(void* data, size_t size);
+void Result_dealloc(pygear_ResultObject* self);
+PyObject* Result_str(pygear_ResultObject* self);
+PyObject* Result_repr(pygear_ResultObject* self);
+PyObject* Result_richcompare(pygear_ResultObject* self, PyObject* other, int op);
+long Result_hash(pygear_ResultObject* self);
+Py_ssize_t Result_length(pygear_ResultObject* self);
+int Result_getbuffer(pygear_ResultObject* self, Py_buffer* view, int flags);
+Py_ssize_t Result_getreadbuffer(pygear_ResultObject* self, Py_ssize_t segment, void** ptr);
+Py_ssize_t Result_getsegcount(pygear_ResultObject* self, Py_ssize_t* lenp);
+
+
+/* Method definitions */
+static PyObject* pygear_result_tobytes(pygear_ResultObject* self);
+PyDoc_STRVAR(pygear_result_tobytes_doc,
+"Return a copy of the result as a str.");
+
+/* Module method specification */
+static PyMethodDef result_module_methods[] = {
+    _RESULTMETHOD(tobytes, METH_NOARGS)
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods result_as_sequence = {
+    (lenfunc)Result_length,                     /* sq_length */
+};
+
+static PyBufferProcs result_as_buffer = {
+    (readbufferproc)Result_getreadbuffer,       /* bf_getreadbuffer */
+    0,                                          /* bf_getwritebuffer */
+    (segcountproc)Result_getsegcount,           /* bf_getsegcount */
+    (charbufferproc)Result_getreadbuffer,       /* bf_getcharbuffer */
+    (getbufferproc)Result_getbuffer,            /* bf_getbuffer */
+    0,                                          /* bf_releasebuffer */
+};
+
+PyTypeObject pygear_ResultType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                          /*ob_size*/
+    "pygear.Result",                            /*tp_name*/
+    sizeof(pygear_ResultObject),                /*tp_basicsize*/
+    0,                                          /*tp_itemsize*/
+    (destructor)Result_dealloc,                 /*tp_dealloc*/
+    0,                                          /*tp_print*/
+    0,                                          /*tp_getattr*/
+    0,                                          /*tp_setattr*/
+    0,                                          /*tp_compare*/
+    (reprfunc)Result_repr,                      /*tp_repr*/
+    0,                                          /*tp_as_number*/
+    &result_as_sequence,                        /*tp_as_sequence*/
+    0,                                          /*tp_as_mapping*/
+    (hashfunc)Result_hash,                      /*tp_hash */
+    0,                                          /*tp_call*/
+    (reprfunc)Result_str,                       /*tp_str*/
+    0,                                          /*tp_getattro*/
+    0,                                          /*tp_setattro*/
+    &result_as_buffer,                          /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT |
+    Py_TPFLAGS_HAVE_NEWBUFFER,                  /*tp_flags*/
+    result_module_docstring,                    /* tp_doc */
+    0,                                          /* tp_traverse */
+    0,                                          /* tp_clear */
+    (richcmpfunc)Result_richcompare,            /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    0,                                          /* tp_iter */
+    0,                                          /* tp_iternext */
+    result_module_methods,                      /* tp_methods */
+};
+
+#endif
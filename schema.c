@@ -0,0 +1,396 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "schema.h"
+
+/*
+ * Class constructor / destructor methods
+ */
+
+static int _pygear_schema_field_type(PyObject* name, PyObject* type) {
+    if (type == (PyObject*) &PyInt_Type || type == (PyObject*) &PyLong_Type) {
+        return PYGEAR_SCHEMA_INT;
+    } else if (type == (PyObject*) &PyFloat_Type) {
+        return PYGEAR_SCHEMA_FLOAT;
+    } else if (type == (PyObject*) &PyBool_Type) {
+        return PYGEAR_SCHEMA_BOOL;
+    } else if (type == (PyObject*) &PyString_Type) {
+        return PYGEAR_SCHEMA_BYTES;
+    } else if (type == (PyObject*) &PyUnicode_Type) {
+        return PYGEAR_SCHEMA_TEXT;
+    } else if (type == (PyObject*) &PyBaseObject_Type) {
+        return PYGEAR_SCHEMA_ANY;
+    }
+    PyObject* name_repr = PyObject_Repr(name);
+    PyErr_Format(PyExc_TypeError,
+        "unsupported type for schema field %s; expected int, long, float, bool, str, unicode or object",
+        name_repr ? PyString_AS_STRING(name_repr) : "?");
+    Py_XDECREF(name_repr);
+    return -1;
+}
+
+static PyObject* _pygear_schema_encode(void* state, PyObject* obj);
+static PyObject* _pygear_schema_decode(void* state, const char* data, Py_ssize_t size);
+
+PyObject* Schema_new(PyTypeObject* type, PyObject* args, PyObject* kwds) {
+    PyObject* spec;
+    static char* kwlist[] = {"spec", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &PyDict_Type, &spec)) {
+        return NULL;
+    }
+    pygear_SchemaObject* self = (pygear_SchemaObject*) type->tp_alloc(type, 0);
+    if (!self) {
+        return NULL;
+    }
+    self->schema_codec.encode = _pygear_schema_encode;
+    self->schema_codec.decode = _pygear_schema_decode;
+    self->schema_codec.state = self;
+    if (Codec_bind(&self->base, &self->schema_codec) == -1) {
+        goto error;
+    }
+
+    PyObject* names = PyDict_Keys(spec);
+    if (!names) {
+        goto error;
+    }
+    if (PyList_Sort(names) == -1) {
+        Py_DECREF(names);
+        goto error;
+    }
+    self->fields = PyList_AsTuple(names);
+    Py_DECREF(names);
+    if (!self->fields) {
+        goto error;
+    }
+
+    Py_ssize_t i, nfields = PyTuple_GET_SIZE(self->fields);
+    self->types = PyMem_Malloc(nfields ? nfields : 1);
+    if (!self->types) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    for (i = 0; i < nfields; ++i) {
+        PyObject* name = PyTuple_GET_ITEM(self->fields, i);
+        if (!PyString_Check(name) && !PyUnicode_Check(name)) {
+            PyErr_SetString(PyExc_TypeError, "schema field names must be str or unicode");
+            goto error;
+        }
+        int field_type = _pygear_schema_field_type(name, PyDict_GetItem(spec, name));
+        if (field_type == -1) {
+            goto error;
+        }
+        self->types[i] = (unsigned char) field_type;
+    }
+    return (PyObject*) self;
+
+error:
+    Py_DECREF(self);
+    return NULL;
+}
+
+void Schema_dealloc(pygear_SchemaObject* self) {
+    Py_CLEAR(self->fields);
+    PyMem_Free(self->types);
+    self->types = NULL;
+    Codec_dealloc(&self->base);
+}
+
+int _pygear_serialize_workload(PyObject* schema, PyObject* serializer, pygear_codec_t* codec,
+    int typed_arrays, PyObject* obj, Py_buffer* view) {
+
+    if (!schema || schema == Py_None) {
+        return _pygear_serialize(serializer, codec, typed_arrays, obj, view);
+    }
+    if (!PyObject_TypeCheck(schema, &pygear_SchemaType)) {
+        PyErr_SetString(PyExc_TypeError, "schema must be a pygear.Schema or None");
+        return -1;
+    }
+    return _pygear_serialize(schema, ((pygear_CodecObject*) schema)->codec, 0, obj, view);
+}
+
+/*
+ * Encoding
+ */
+
+static int _pygear_schema_write_varint(pygear_msgpack_writer* writer, uint64_t value) {
+    unsigned char buf[10];
+    int size = 0;
+    while (value >= 0x80) {
+        buf[size++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    buf[size++] = (unsigned char) value;
+    return _pygear_msgpack_write(writer, buf, size);
+}
+
+static int _pygear_schema_write_bytes(pygear_msgpack_writer* writer, const char* data, Py_ssize_t size) {
+    if (_pygear_schema_write_varint(writer, (uint64_t) size) == -1) {
+        return -1;
+    }
+    return _pygear_msgpack_write(writer, data, size);
+}
+
+static int _pygear_schema_type_error(PyObject* name, const char* expected) {
+    PyObject* name_repr = PyObject_Repr(name);
+    PyErr_Format(PyExc_TypeError, "schema field %s expects %s",
+        name_repr ? PyString_AS_STRING(name_repr) : "?", expected);
+    Py_XDECREF(name_repr);
+    return -1;
+}
+
+static int _pygear_schema_pack_field(pygear_msgpack_writer* writer, PyObject* name, int type, PyObject* value) {
+    switch (type) {
+        case PYGEAR_SCHEMA_INT: {
+            if (!PyInt_Check(value) && !PyLong_Check(value)) {
+                return _pygear_schema_type_error(name, "an int");
+            }
+            PY_LONG_LONG v = PyLong_AsLongLong(value);
+            if (v == -1 && PyErr_Occurred()) {
+                return -1;
+            }
+            // zigzag, so that small negative numbers stay short too
+            return _pygear_schema_write_varint(writer, ((uint64_t) v << 1) ^ (uint64_t) (v >> 63));
+        }
+        case PYGEAR_SCHEMA_FLOAT: {
+            if (!PyFloat_Check(value) && !PyInt_Check(value) && !PyLong_Check(value)) {
+                return _pygear_schema_type_error(name, "a float");
+            }
+            double d = PyFloat_AsDouble(value);
+            unsigned char buf[8];
+            if ((d == -1.0 && PyErr_Occurred()) || _PyFloat_Pack8(d, buf, 1) == -1) {
+                return -1;
+            }
+            return _pygear_msgpack_write(writer, buf, 8);
+        }
+        case PYGEAR_SCHEMA_BOOL: {
+            if (!PyBool_Check(value)) {
+                return _pygear_schema_type_error(name, "a bool");
+            }
+            unsigned char b = (value == Py_True);
+            return _pygear_msgpack_write(writer, &b, 1);
+        }
+        case PYGEAR_SCHEMA_BYTES:
+            if (!PyString_Check(value)) {
+                return _pygear_schema_type_error(name, "a str");
+            }
+            return _pygear_schema_write_bytes(writer, PyString_AS_STRING(value), PyString_GET_SIZE(value));
+        case PYGEAR_SCHEMA_TEXT: {
+            if (!PyUnicode_Check(value)) {
+                return _pygear_schema_type_error(name, "a unicode");
+            }
+            PyObject* utf8 = PyUnicode_AsUTF8String(value);
+            if (!utf8) {
+                return -1;
+            }
+            int ret = _pygear_schema_write_bytes(writer, PyString_AS_STRING(utf8), PyString_GET_SIZE(utf8));
+            Py_DECREF(utf8);
+            return ret;
+        }
+    }
+    return _pygear_msgpack_pack(writer, value);
+}
+
+/* Raise ValueError naming a key of obj that the schema does not declare */
+static void _pygear_schema_unknown_field(pygear_SchemaObject* self, PyObject* obj) {
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(obj, &pos, &key, &value)) {
+        int known = PySequence_Contains(self->fields, key);
+        if (known == -1) {
+            return;
+        }
+        if (!known) {
+            PyObject* key_repr = PyObject_Repr(key);
+            PyErr_Format(PyExc_ValueError, "field %s is not in the schema",
+                key_repr ? PyString_AS_STRING(key_repr) : "?");
+            Py_XDECREF(key_repr);
+            return;
+        }
+    }
+    PyErr_SetString(PyExc_ValueError, "dict does not match the schema");
+}
+
+static PyObject* _pygear_schema_encode(void* state, PyObject* obj) {
+    pygear_SchemaObject* self = (pygear_SchemaObject*) state;
+    Py_ssize_t i, nfields = PyTuple_GET_SIZE(self->fields);
+    Py_ssize_t bitmap_size = (nfields + 7) / 8;
+    Py_ssize_t present = 0;
+
+    if (!PyDict_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "schema payload must be a dict, not %.200s", Py_TYPE(obj)->tp_name);
+        return NULL;
+    }
+
+    pygear_msgpack_writer writer;
+    writer.len = 0;
+    writer.str = PyString_FromStringAndSize(NULL, PYGEAR_MSGPACK_INITIAL_SIZE);
+    if (!writer.str) {
+        return NULL;
+    }
+    // Field count, so that a payload from a different schema is caught early
+    if (_pygear_schema_write_varint(&writer, (uint64_t) nfields) == -1
+        || _pygear_msgpack_reserve(&writer, bitmap_size) == -1) {
+        goto error;
+    }
+    Py_ssize_t bitmap_offset = writer.len;
+    memset(PyString_AS_STRING(writer.str) + bitmap_offset, 0, bitmap_size);
+    writer.len += bitmap_size;
+
+    for (i = 0; i < nfields; ++i) {
+        PyObject* name = PyTuple_GET_ITEM(self->fields, i);
+        PyObject* value = PyDict_GetItem(obj, name);
+        if (value) {
+            ++present;
+        }
+        if (!value || value == Py_None) {
+            // The writer may have moved since the bitmap was reserved
+            PyString_AS_STRING(writer.str)[bitmap_offset + i / 8] |= (char) (1 << (i % 8));
+            continue;
+        }
+        if (_pygear_schema_pack_field(&writer, name, self->types[i], value) == -1) {
+            goto error;
+        }
+    }
+    if (present != PyDict_Size(obj)) {
+        _pygear_schema_unknown_field(self, obj);
+        goto error;
+    }
+    if (_PyString_Resize(&writer.str, writer.len) == -1) {
+        return NULL;
+    }
+    return writer.str;
+
+error:
+    Py_XDECREF(writer.str);
+    return NULL;
+}
+
+/*
+ * Decoding
+ */
+
+static int _pygear_schema_read_varint(pygear_msgpack_reader* reader, uint64_t* value) {
+    uint64_t result = 0;
+    int shift;
+    for (shift = 0; shift < 64; shift += 7) {
+        if (_pygear_msgpack_need(reader, 1) == -1) {
+            return -1;
+        }
+        unsigned char byte = *reader->pos++;
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    PyErr_SetString(PyExc_ValueError, "malformed varint in schema payload");
+    return -1;
+}
+
+static PyObject* _pygear_schema_unpack_field(pygear_msgpack_reader* reader, int type) {
+    uint64_t value;
+    switch (type) {
+        case PYGEAR_SCHEMA_INT:
+            if (_pygear_schema_read_varint(reader, &value) == -1) {
+                return NULL;
+            }
+            return _pygear_msgpack_int((PY_LONG_LONG) ((value >> 1) ^ (~(value & 1) + 1)));
+        case PYGEAR_SCHEMA_FLOAT:
+            if (_pygear_msgpack_need(reader, 8) == -1) {
+                return NULL;
+            }
+            reader->pos += 8;
+            return PyFloat_FromDouble(_PyFloat_Unpack8(reader->pos - 8, 1));
+        case PYGEAR_SCHEMA_BOOL:
+            if (_pygear_msgpack_need(reader, 1) == -1) {
+                return NULL;
+            }
+            return PyBool_FromLong(*reader->pos++);
+        case PYGEAR_SCHEMA_BYTES:
+        case PYGEAR_SCHEMA_TEXT:
+            if (_pygear_schema_read_varint(reader, &value) == -1) {
+                return NULL;
+            }
+            if (value > (uint64_t) PY_SSIZE_T_MAX) {
+                PyErr_SetString(PyExc_ValueError, "truncated schema payload");
+                return NULL;
+            }
+            return _pygear_msgpack_unpack_bytes(reader, (Py_ssize_t) value, type == PYGEAR_SCHEMA_TEXT);
+    }
+    return _pygear_msgpack_unpack(reader);
+}
+
+static PyObject* _pygear_schema_decode(void* state, const char* data, Py_ssize_t size) {
+    pygear_SchemaObject* self = (pygear_SchemaObject*) state;
+    Py_ssize_t i, nfields = PyTuple_GET_SIZE(self->fields);
+    Py_ssize_t bitmap_size = (nfields + 7) / 8;
+    pygear_msgpack_reader reader;
+    reader.pos = (const unsigned char*) data;
+    reader.end = reader.pos + size;
+
+    uint64_t encoded_fields;
+    if (_pygear_schema_read_varint(&reader, &encoded_fields) == -1) {
+        return NULL;
+    }
+    if (encoded_fields != (uint64_t) nfields) {
+        PyErr_Format(PyExc_ValueError, "payload has %llu fields, schema has %zd",
+            (unsigned long long) encoded_fields, nfields);
+        return NULL;
+    }
+    if (_pygear_msgpack_need(&reader, bitmap_size) == -1) {
+        return NULL;
+    }
+    const unsigned char* bitmap = reader.pos;
+    reader.pos += bitmap_size;
+
+    PyObject* dict = _PyDict_NewPresized(nfields);
+    if (!dict) {
+        return NULL;
+    }
+    for (i = 0; i < nfields; ++i) {
+        PyObject* value;
+        if (bitmap[i / 8] & (1 << (i % 8))) {
+            Py_INCREF(Py_None);
+            value = Py_None;
+        } else {
+            value = _pygear_schema_unpack_field(&reader, self->types[i]);
+        }
+        if (!value || PyDict_SetItem(dict, PyTuple_GET_ITEM(self->fields, i), value) == -1) {
+            Py_XDECREF(value);
+            Py_DECREF(dict);
+            return NULL;
+        }
+        Py_DECREF(value);
+    }
+    if (reader.pos != reader.end) {
+        Py_DECREF(dict);
+        PyErr_SetString(PyExc_ValueError, "extra data after schema payload");
+        return NULL;
+    }
+    return dict;
+}
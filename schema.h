@@ -0,0 +1,125 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include "structmember.h"
+#include "serializer.h"
+#include "codec.h"
+#include "msgpack_codec.h"
+
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+/* Field types a schema can declare, keyed by the Python type in the spec */
+enum {
+    PYGEAR_SCHEMA_INT,      /* int, long: zigzag varint */
+    PYGEAR_SCHEMA_FLOAT,    /* float: 8-byte little-endian double */
+    PYGEAR_SCHEMA_BOOL,     /* bool: one byte */
+    PYGEAR_SCHEMA_BYTES,    /* str: varint length + bytes */
+    PYGEAR_SCHEMA_TEXT,     /* unicode: varint length + UTF-8 */
+    PYGEAR_SCHEMA_ANY       /* object: msgpack value */
+};
+
+typedef struct {
+    pygear_CodecObject base;
+    pygear_codec_t schema_codec;    /* base.codec points here */
+    PyObject* fields;               /* field names, sorted */
+    unsigned char* types;           /* PYGEAR_SCHEMA_* per field */
+} pygear_SchemaObject;
+
+PyDoc_STRVAR(schema_module_docstring,
+"Schema(spec)\n\n"
+"A codec for dicts that always carry the same keys. spec maps each field\n"
+"name to its type: int, long, float, bool, str, unicode, or object for any\n"
+"value MSGPACK can encode. Fields are packed positionally in sorted name\n"
+"order behind a bitmap of the ones that are None or missing, so no key\n"
+"strings go over the wire. Decoding returns a dict holding every field,\n"
+"with None for missing ones. Both ends must use the same spec.\n\n"
+"Example:\n"
+"resize = pygear.Schema({'url': unicode, 'width': int, 'height': int})\n"
+"w.add_function('resize', 0, do_resize, schema=resize)\n"
+"c.do('resize', {'url': u'...', 'width': 64, 'height': 64}, schema=resize)");
+
+/* Class init methods */
+PyObject* Schema_new(PyTypeObject* type, PyObject* args, PyObject* kwds);
+void Schema_dealloc(pygear_SchemaObject* self);
+
+/* Serialize a workload with schema when one is given (not NULL or None), and
+ * with serializer/codec otherwise. Returns 0 or -1 like _pygear_serialize. */
+int _pygear_serialize_workload(PyObject* schema, PyObject* serializer, pygear_codec_t* codec,
+    int typed_arrays, PyObject* obj, Py_buffer* view);
+
+static PyMemberDef schema_module_members[] = {
+    {"fields", T_OBJECT, offsetof(pygear_SchemaObject, fields), READONLY,
+     "Field names in wire order"},
+    {NULL}
+};
+
+PyTypeObject pygear_SchemaType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                          /*ob_size*/
+    "pygear.Schema",                            /*tp_name*/
+    sizeof(pygear_SchemaObject),                /*tp_basicsize*/
+    0,                                          /*tp_itemsize*/
+    (destructor)Schema_dealloc,                 /*tp_dealloc*/
+    0,                                          /*tp_print*/
+    0,                                          /*tp_getattr*/
+    0,                                          /*tp_setattr*/
+    0,                                          /*tp_compare*/
+    0,                                          /*tp_repr*/
+    0,                                          /*tp_as_number*/
+    0,                                          /*tp_as_sequence*/
+    0,                                          /*tp_as_mapping*/
+    0,                                          /*tp_hash */
+    0,                                          /*tp_call*/
+    0,                                          /*tp_str*/
+    0,                                          /*tp_getattro*/
+    0,                                          /*tp_setattro*/
+    0,                                          /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,                         /*tp_flags*/
+    schema_module_docstring,                    /* tp_doc */
+    0,                                          /* tp_traverse */
+    0,                                          /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    0,                                          /* tp_iter */
+    0,                                          /* tp_iternext */
+    0,                                          /* tp_methods */
+    schema_module_members,                      /* tp_members */
+    0,                                          /* tp_getset */
+    &pygear_CodecType,                          /* tp_base */
+    0,                                          /* tp_dict */
+    0,                                          /* tp_descr_get */
+    0,                                          /* tp_descr_set */
+    0,                                          /* tp_dictoffset */
+    0,                                          /* tp_init */
+    0,                                          /* tp_alloc */
+    Schema_new,                                 /* tp_new */
+};
+
+#endif
@@ -0,0 +1,601 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "serializer.h"
+
+static PyObject* _pygear_default_serializer_module = NULL;
+static PyObject* _pygear_str_dumps = NULL;
+static PyObject* _pygear_str_loads = NULL;
+
+static int _pygear_serializer_intern_names(void) {
+    if (!_pygear_str_dumps) {
+        _pygear_str_dumps = PyString_InternFromString("dumps");
+        if (!_pygear_str_dumps) {
+            return -1;
+        }
+    }
+    if (!_pygear_str_loads) {
+        _pygear_str_loads = PyString_InternFromString("loads");
+        if (!_pygear_str_loads) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+PyObject* _pygear_default_serializer(void) {
+    if (!_pygear_default_serializer_module) {
+        _pygear_default_serializer_module = PyImport_ImportModule(PYTHON_SERIALIZER);
+        if (!_pygear_default_serializer_module) {
+            PyObject* err_string = PyString_FromFormat("Failed to import '%s'", PYTHON_SERIALIZER);
+            PyErr_SetObject(PyExc_ImportError, err_string);
+            Py_XDECREF(err_string);
+            return NULL;
+        }
+    }
+    Py_INCREF(_pygear_default_serializer_module);
+    return _pygear_default_serializer_module;
+}
+
+pygear_codec_t* _pygear_lookup_codec(PyObject* serializer) {
+    if (PYGEAR_IS_RAW(serializer)) {
+        return NULL;
+    }
+    PyObject* capsule = PyObject_GetAttrString(serializer, PYGEAR_CODEC_ATTR);
+    if (!capsule) {
+        PyErr_Clear();
+        return NULL;
+    }
+    pygear_codec_t* codec = NULL;
+    if (PyCapsule_IsValid(capsule, PYGEAR_CODEC_CAPSULE)) {
+        codec = (pygear_codec_t*) PyCapsule_GetPointer(capsule, PYGEAR_CODEC_CAPSULE);
+    }
+    Py_DECREF(capsule);
+    return codec;
+}
+
+int _pygear_parse_serializer(PyObject* args, PyObject* kwargs, PyObject** serializer, int* typed_arrays) {
+    PyObject* py_typed_arrays = Py_False;
+    static char* kwlist[] = {"serializer", "typed_arrays", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, serializer, &py_typed_arrays)) {
+        return -1;
+    }
+    if (_pygear_check_serializer(*serializer) == -1) {
+        return -1;
+    }
+    *typed_arrays = PyObject_IsTrue(py_typed_arrays);
+    return (*typed_arrays == -1 ? -1 : 0);
+}
+
+int _pygear_check_serializer(PyObject* serializer) {
+    if (PYGEAR_IS_RAW(serializer)) {
+        return 0;
+    }
+    if (!PyObject_HasAttrString(serializer, "loads")) {
+        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'loads'");
+        return -1;
+    }
+    if (!PyObject_HasAttrString(serializer, "dumps")) {
+        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'dumps'");
+        return -1;
+    }
+    return 0;
+}
+
+int _pygear_get_buffer(PyObject* obj, Py_buffer* view) {
+    if (PyUnicode_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError, "unicode payloads must be encoded to str first");
+        return -1;
+    }
+    if (PyObject_CheckBuffer(obj)) {
+        return PyObject_GetBuffer(obj, view, PyBUF_SIMPLE);
+    }
+    // mmap and array only implement the old-style buffer interface on 2.7
+    const void* data;
+    Py_ssize_t size;
+    if (PyObject_AsReadBuffer(obj, &data, &size) == -1) {
+        PyErr_Format(PyExc_TypeError,
+            "expected an object supporting the buffer protocol, got %.200s",
+            Py_TYPE(obj)->tp_name);
+        return -1;
+    }
+    return PyBuffer_FillInfo(view, obj, (void*) data, size, 1, PyBUF_SIMPLE);
+}
+
+/*
+ * Typed numeric arrays
+ */
+
+static PyObject* _pygear_array_type = NULL;
+
+/* array.array, imported once; borrowed reference */
+static PyObject* _pygear_get_array_type(void) {
+    if (!_pygear_array_type) {
+        PyObject* module = PyImport_ImportModule("array");
+        if (!module) {
+            return NULL;
+        }
+        _pygear_array_type = PyObject_GetAttrString(module, "array");
+        Py_DECREF(module);
+    }
+    return _pygear_array_type;
+}
+
+/* Wire code for elements of the given format letter and size, 0 if not numeric */
+static char _pygear_typed_array_code(char format, Py_ssize_t itemsize) {
+    enum {SIGNED, UNSIGNED, FLOAT} kind;
+    switch (format) {
+        case 'b': case 'h': case 'i': case 'l': case 'q':
+            kind = SIGNED;
+            break;
+        case 'B': case 'H': case 'I': case 'L': case 'Q':
+            kind = UNSIGNED;
+            break;
+        case 'f': case 'd':
+            kind = FLOAT;
+            break;
+        default:
+            return 0;
+    }
+    switch (itemsize) {
+        case 1:
+            return (kind == SIGNED ? 'b' : kind == UNSIGNED ? 'B' : 0);
+        case 2:
+            return (kind == SIGNED ? 'h' : kind == UNSIGNED ? 'H' : 0);
+        case 4:
+            return (kind == SIGNED ? 'i' : kind == UNSIGNED ? 'I' : 'f');
+        case 8:
+            return (kind == SIGNED ? 'q' : kind == UNSIGNED ? 'Q' : 'd');
+    }
+    return 0;
+}
+
+/*
+ * Encode obj as a typed array if it is one: an array.array, or a
+ * one-dimensional buffer with a numeric format other than 'B', which is what
+ * memoryviews and other byte buffers export. Returns 1 with view filled in,
+ * 0 if obj is not a typed array, -1 with an exception set.
+ */
+static int _pygear_pack_typed_array(PyObject* obj, Py_buffer* view) {
+    if (PyString_Check(obj) || PyByteArray_Check(obj) || PyUnicode_Check(obj)) {
+        return 0;
+    }
+    PyObject* array_type = _pygear_get_array_type();
+    if (!array_type) {
+        return -1;
+    }
+
+    Py_buffer source;
+    int has_source = 0;
+    const void* data;
+    Py_ssize_t size, itemsize;
+    char format;
+#ifdef WORDS_BIGENDIAN
+    int big_endian = 1;
+#else
+    int big_endian = 0;
+#endif
+
+    if (PyObject_TypeCheck(obj, (PyTypeObject*) array_type)) {
+        // array.array only has the old-style buffer interface on 2.7
+        PyObject* typecode = PyObject_GetAttrString(obj, "typecode");
+        if (!typecode) {
+            return -1;
+        }
+        format = PyString_Check(typecode) ? PyString_AS_STRING(typecode)[0] : 0;
+        Py_DECREF(typecode);
+        PyObject* py_itemsize = PyObject_GetAttrString(obj, "itemsize");
+        if (!py_itemsize) {
+            return -1;
+        }
+        itemsize = PyInt_AsSsize_t(py_itemsize);
+        Py_DECREF(py_itemsize);
+        if (PyObject_AsReadBuffer(obj, &data, &size) == -1) {
+            return -1;
+        }
+    } else if (PyObject_CheckBuffer(obj)) {
+        if (PyObject_GetBuffer(obj, &source, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) == -1) {
+            // Not something we can send as a flat array, leave it to the serializer
+            PyErr_Clear();
+            return 0;
+        }
+        has_source = 1;
+        const char* buffer_format = source.format;
+        if (buffer_format && strchr("@=<>!", buffer_format[0])) {
+            if (buffer_format[0] == '<') {
+                big_endian = 0;
+            } else if (buffer_format[0] == '>' || buffer_format[0] == '!') {
+                big_endian = 1;
+            }
+            ++buffer_format;
+        }
+        // Only plain single-letter formats; anything like "2d" or "T{...}" is not an array,
+        // and neither is a matrix, which would lose its shape
+        format = (buffer_format && buffer_format[0] && !buffer_format[1]) ? buffer_format[0] : 0;
+        if (source.ndim != 1 || format == 'B') {
+            format = 0;
+        }
+        data = source.buf;
+        size = source.len;
+        itemsize = source.itemsize;
+    } else {
+        return 0;
+    }
+
+    char code = _pygear_typed_array_code(format, itemsize);
+    if (!code) {
+        if (has_source) {
+            PyBuffer_Release(&source);
+        }
+        return 0;
+    }
+    PyObject* encoded = PyString_FromStringAndSize(NULL, PYGEAR_TYPED_ARRAY_HEADER_SIZE + size);
+    if (encoded) {
+        char* out = PyString_AS_STRING(encoded);
+        memcpy(out, PYGEAR_ENVELOPE_MAGIC, PYGEAR_ENVELOPE_MAGIC_SIZE);
+        out[PYGEAR_ENVELOPE_MAGIC_SIZE] = PYGEAR_ENVELOPE_TYPED_ARRAY;
+        out[PYGEAR_ENVELOPE_HEADER_SIZE] = code;
+        out += PYGEAR_TYPED_ARRAY_HEADER_SIZE;
+        if (big_endian && itemsize > 1) {
+            const char* in = (const char*) data;
+            Py_ssize_t i, j;
+            for (i = 0; i < size; i += itemsize) {
+                for (j = 0; j < itemsize; ++j) {
+                    out[i + j] = in[i + itemsize - 1 - j];
+                }
+            }
+        } else {
+            memcpy(out, data, size);
+        }
+    }
+    if (has_source) {
+        PyBuffer_Release(&source);
+    }
+    if (!encoded) {
+        return -1;
+    }
+    int ret = _pygear_get_buffer(encoded, view);
+    Py_DECREF(encoded);
+    return (ret == -1 ? -1 : 1);
+}
+
+static PyObject* _pygear_unpack_typed_array(const char* data, Py_ssize_t size) {
+    char typecode;
+    Py_ssize_t itemsize;
+    switch (data[PYGEAR_ENVELOPE_HEADER_SIZE]) {
+        case 'b': typecode = 'b'; itemsize = 1; break;
+        case 'B': typecode = 'B'; itemsize = 1; break;
+        case 'h': typecode = 'h'; itemsize = 2; break;
+        case 'H': typecode = 'H'; itemsize = 2; break;
+        case 'i': typecode = 'i'; itemsize = 4; break;
+        case 'I': typecode = 'I'; itemsize = 4; break;
+        case 'f': typecode = 'f'; itemsize = 4; break;
+        case 'd': typecode = 'd'; itemsize = 8; break;
+#if SIZEOF_LONG == 8
+        case 'q': typecode = 'l'; itemsize = 8; break;
+        case 'Q': typecode = 'L'; itemsize = 8; break;
+#endif
+        default:
+            PyErr_Format(PyExc_ValueError, "unsupported typed array element code '%c'",
+                data[PYGEAR_ENVELOPE_HEADER_SIZE]);
+            return NULL;
+    }
+    data += PYGEAR_TYPED_ARRAY_HEADER_SIZE;
+    size -= PYGEAR_TYPED_ARRAY_HEADER_SIZE;
+    if (size % itemsize) {
+        PyErr_SetString(PyExc_ValueError, "typed array payload is not a whole number of elements");
+        return NULL;
+    }
+    PyObject* array_type = _pygear_get_array_type();
+    if (!array_type) {
+        return NULL;
+    }
+    PyObject* array = PyObject_CallFunction(array_type, "c", typecode);
+    // Wrap the libgearman buffer so that fromstring copies it exactly once
+    PyObject* chunk = array ? PyBuffer_FromMemory((void*) data, size) : NULL;
+    PyObject* ret = chunk ? PyObject_CallMethod(array, "fromstring", "O", chunk) : NULL;
+#ifdef WORDS_BIGENDIAN
+    if (ret && itemsize > 1) {
+        Py_DECREF(ret);
+        ret = PyObject_CallMethod(array, "byteswap", NULL);
+    }
+#endif
+    Py_XDECREF(chunk);
+    if (!ret) {
+        Py_XDECREF(array);
+        return NULL;
+    }
+    Py_DECREF(ret);
+    return array;
+}
+
+int _pygear_serialize(PyObject* serializer, pygear_codec_t* codec, int typed_arrays, PyObject* obj,
+    Py_buffer* view) {
+    PyObject* encoded = NULL;
+    int ret;
+    if (PYGEAR_IS_RAW(serializer)) {
+        if (obj == Py_None) {
+            return PyBuffer_FillInfo(view, NULL, (void*) "", 0, 1, PyBUF_SIMPLE);
+        }
+        return _pygear_get_buffer(obj, view);
+    }
+    if (typed_arrays) {
+        ret = _pygear_pack_typed_array(obj, view);
+        if (ret != 0) {
+            return (ret == 1 ? 0 : -1);
+        }
+    }
+    if (codec) {
+        encoded = codec->encode(codec->state, obj);
+    } else {
+        if (_pygear_serializer_intern_names() == -1) {
+            return -1;
+        }
+        encoded = PyObject_CallMethodObjArgs(serializer, _pygear_str_dumps, obj, NULL);
+    }
+    if (encoded && PyUnicode_Check(encoded)) {
+        // Keep accepting serializers that hand back unicode
+        PyObject* as_str = PyUnicode_AsEncodedString(encoded, NULL, NULL);
+        Py_DECREF(encoded);
+        encoded = as_str;
+    }
+    if (!encoded) {
+        return -1;
+    }
+    ret = _pygear_get_buffer(encoded, view);
+    Py_DECREF(encoded);
+    return ret;
+}
+
+static PyObject* _pygear_deserialize_payload(PyObject* serializer, pygear_codec_t* codec,
+    int typed_arrays, const char* data, Py_ssize_t size, int allow_compressed);
+
+/* Decompress a zlib envelope and deserialize what was inside it. The size in
+ * the header comes from the peer, so the output buffer only grows as the
+ * stream actually inflates, and a stream going past that size is rejected. */
+static PyObject* _pygear_decompress(PyObject* serializer, pygear_codec_t* codec, int typed_arrays,
+    const char* data, Py_ssize_t size) {
+    if (size < PYGEAR_ZLIB_HEADER_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "truncated compressed payload");
+        return NULL;
+    }
+    const unsigned char* header = (const unsigned char*) data + PYGEAR_ENVELOPE_HEADER_SIZE;
+    uLong expected_size = header[0] | (header[1] << 8) | (header[2] << 16) | ((uLong) header[3] << 24);
+    uLong compressed_size = size - PYGEAR_ZLIB_HEADER_SIZE;
+    uLong capacity = PYGEAR_ZLIB_INITIAL_OUTPUT;
+    if (capacity < 4 * compressed_size) {
+        capacity = 4 * compressed_size;
+    }
+    if (capacity > expected_size) {
+        capacity = expected_size;
+    }
+    PyObject* decompressed = PyString_FromStringAndSize(NULL, capacity);
+    if (!decompressed) {
+        return NULL;
+    }
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (Bytef*) data + PYGEAR_ZLIB_HEADER_SIZE;
+    stream.avail_in = compressed_size;
+    int status = inflateInit(&stream);
+    if (status != Z_OK) {
+        Py_DECREF(decompressed);
+        PyErr_Format(PyExc_ValueError, "zlib initialization failed (status %d)", status);
+        return NULL;
+    }
+    while (1) {
+        stream.next_out = (Bytef*) PyString_AS_STRING(decompressed) + stream.total_out;
+        stream.avail_out = capacity - stream.total_out;
+        Py_BEGIN_ALLOW_THREADS
+        status = inflate(&stream, Z_NO_FLUSH);
+        Py_END_ALLOW_THREADS
+        if (status == Z_STREAM_END || (status != Z_OK && status != Z_BUF_ERROR)) {
+            break;
+        }
+        if (stream.avail_out > 0 || capacity == expected_size) {
+            // Out of input before the end of the stream, or more output than announced
+            status = Z_DATA_ERROR;
+            break;
+        }
+        capacity = (capacity * 2 < expected_size ? capacity * 2 : expected_size);
+        if (_PyString_Resize(&decompressed, capacity) == -1) {
+            inflateEnd(&stream);
+            return NULL;
+        }
+    }
+    uLong decompressed_size = stream.total_out;
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END || decompressed_size != expected_size) {
+        Py_DECREF(decompressed);
+        PyErr_Format(PyExc_ValueError, "corrupt compressed payload (zlib status %d)", status);
+        return NULL;
+    }
+    // A compressed envelope never holds another one
+    PyObject* ret = _pygear_deserialize_payload(serializer, codec, typed_arrays,
+        PyString_AS_STRING(decompressed), decompressed_size, 0);
+    Py_DECREF(decompressed);
+    return ret;
+}
+
+PyObject* _pygear_deserialize(PyObject* serializer, pygear_codec_t* codec, int typed_arrays,
+    const char* data, Py_ssize_t size) {
+    return _pygear_deserialize_payload(serializer, codec, typed_arrays, data, size, 1);
+}
+
+static PyObject* _pygear_deserialize_payload(PyObject* serializer, pygear_codec_t* codec,
+    int typed_arrays, const char* data, Py_ssize_t size, int allow_compressed) {
+
+    if (!data) {
+        data = "";
+        size = 0;
+    }
+    if (!PYGEAR_IS_RAW(serializer) && size >= PYGEAR_ENVELOPE_HEADER_SIZE
+        && memcmp(data, PYGEAR_ENVELOPE_MAGIC, PYGEAR_ENVELOPE_MAGIC_SIZE) == 0) {
+        switch (data[PYGEAR_ENVELOPE_MAGIC_SIZE]) {
+            case PYGEAR_ENVELOPE_TYPED_ARRAY:
+                if (typed_arrays && size >= PYGEAR_TYPED_ARRAY_HEADER_SIZE) {
+                    return _pygear_unpack_typed_array(data, size);
+                }
+                break;
+            case PYGEAR_ENVELOPE_ZLIB:
+                if (allow_compressed) {
+                    return _pygear_decompress(serializer, codec, typed_arrays, data, size);
+                }
+                break;
+        }
+    }
+    if (codec) {
+        // Native codecs read straight from libgearman's buffer
+        return codec->decode(codec->state, data, size);
+    }
+    PyObject* py_data = PyString_FromStringAndSize(data, size);
+    if (!py_data || PYGEAR_IS_RAW(serializer)) {
+        return py_data;
+    }
+    if (_pygear_serializer_intern_names() == -1) {
+        Py_DECREF(py_data);
+        return NULL;
+    }
+    PyObject* decoded = PyObject_CallMethodObjArgs(serializer, _pygear_str_loads, py_data, NULL);
+    Py_DECREF(py_data);
+    return decoded;
+}
+
+/*
+ * Compression
+ */
+
+PyObject* _pygear_set_compression(PyObject* args, PyObject* kwargs,
+    pygear_compression_t* defaults, PyObject* function_map) {
+
+    PyObject* py_threshold;
+    int level = Z_DEFAULT_COMPRESSION;
+    char* function = NULL;
+    static char* kwlist[] = {"threshold", "level", "function", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iz", kwlist, &py_threshold, &level, &function)) {
+        return NULL;
+    }
+    Py_ssize_t threshold = -1;
+    if (py_threshold != Py_None) {
+        threshold = PyNumber_AsSsize_t(py_threshold, PyExc_OverflowError);
+        if (threshold == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (threshold < 0) {
+            PyErr_SetString(PyExc_ValueError, "threshold must be >= 0, or None to disable compression");
+            return NULL;
+        }
+    }
+    if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION) {
+        PyErr_SetString(PyExc_ValueError, "level must be between -1 and 9");
+        return NULL;
+    }
+    if (!function) {
+        defaults->threshold = threshold;
+        defaults->level = level;
+        Py_RETURN_NONE;
+    }
+    PyObject* settings = Py_BuildValue("(ni)", threshold, level);
+    if (!settings) {
+        return NULL;
+    }
+    int ret = PyDict_SetItemString(function_map, function, settings);
+    Py_DECREF(settings);
+    if (ret == -1) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+void _pygear_compression_for(PyObject* function_map, const pygear_compression_t* defaults,
+    const char* function, pygear_compression_t* compression) {
+
+    *compression = *defaults;
+    if (!function_map || PyDict_Size(function_map) == 0 || !function) {
+        return;
+    }
+    // borrowed
+    PyObject* settings = PyDict_GetItemString(function_map, function);
+    if (settings) {
+        compression->threshold = PyInt_AsSsize_t(PyTuple_GET_ITEM(settings, 0));
+        compression->level = (int) PyInt_AsLong(PyTuple_GET_ITEM(settings, 1));
+    }
+}
+
+int _pygear_compress(PyObject* serializer, const pygear_compression_t* compression, Py_buffer* view) {
+    if (PYGEAR_IS_RAW(serializer) || compression->threshold < 0
+        || view->len < compression->threshold || (uint64_t) view->len > 0xffffffffULL) {
+        return 0;
+    }
+    uLongf compressed_size = compressBound(view->len);
+    PyObject* compressed = PyString_FromStringAndSize(NULL, PYGEAR_ZLIB_HEADER_SIZE + compressed_size);
+    if (!compressed) {
+        return -1;
+    }
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = compress2(
+        (Bytef*) PyString_AS_STRING(compressed) + PYGEAR_ZLIB_HEADER_SIZE,
+        &compressed_size,
+        (const Bytef*) view->buf,
+        view->len,
+        compression->level
+    );
+    Py_END_ALLOW_THREADS
+    if (status != Z_OK) {
+        Py_DECREF(compressed);
+        PyErr_Format(PyExc_ValueError, "zlib compression failed (status %d)", status);
+        return -1;
+    }
+    if (PYGEAR_ZLIB_HEADER_SIZE + (Py_ssize_t) compressed_size >= view->len) {
+        // Not worth it, send the payload as it is
+        Py_DECREF(compressed);
+        return 0;
+    }
+    unsigned char* header = (unsigned char*) PyString_AS_STRING(compressed);
+    uint64_t size = (uint64_t) view->len;
+    memcpy(header, PYGEAR_ENVELOPE_MAGIC, PYGEAR_ENVELOPE_MAGIC_SIZE);
+    header[PYGEAR_ENVELOPE_MAGIC_SIZE] = PYGEAR_ENVELOPE_ZLIB;
+    header[PYGEAR_ENVELOPE_HEADER_SIZE] = size & 0xff;
+    header[PYGEAR_ENVELOPE_HEADER_SIZE + 1] = (size >> 8) & 0xff;
+    header[PYGEAR_ENVELOPE_HEADER_SIZE + 2] = (size >> 16) & 0xff;
+    header[PYGEAR_ENVELOPE_HEADER_SIZE + 3] = (size >> 24) & 0xff;
+    if (_PyString_Resize(&compressed, PYGEAR_ZLIB_HEADER_SIZE + compressed_size) == -1) {
+        return -1;
+    }
+    Py_buffer compressed_view;
+    if (_pygear_get_buffer(compressed, &compressed_view) == -1) {
+        Py_DECREF(compressed);
+        return -1;
+    }
+    // The view keeps its own reference to the compressed string
+    Py_DECREF(compressed);
+    PyBuffer_Release(view);
+    *view = compressed_view;
+    return 0;
+}
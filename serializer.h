@@ -0,0 +1,156 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include <stdint.h>
+#include <zlib.h>
+
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+/*
+ * Passing None to set_serializer (exported as pygear.RAW) turns
+ * serialization off: workloads and results travel as plain strings and no
+ * Python-level dumps/loads call is made.
+ */
+#define PYGEAR_IS_RAW(serializer) ((serializer) == Py_None)
+
+/*
+ * Native codec protocol. A serializer that carries a PyCapsule named
+ * PYGEAR_CODEC_CAPSULE in its PYGEAR_CODEC_ATTR attribute is called through
+ * these function pointers instead of its Python 'dumps' and 'loads'. The
+ * codec must stay valid for as long as the serializer object is alive.
+ */
+#define PYGEAR_CODEC_CAPSULE "pygear.codec"
+#define PYGEAR_CODEC_ATTR "_pygear_codec"
+
+typedef struct pygear_codec {
+    /* Encode obj; returns a new reference to a str, NULL with an exception set */
+    PyObject* (*encode)(void* state, PyObject* obj);
+    /* Decode size bytes at data; returns a new reference */
+    PyObject* (*decode)(void* state, const char* data, Py_ssize_t size);
+    void* state;
+} pygear_codec_t;
+
+/* Return the native codec of serializer, or NULL if it only has dumps/loads */
+pygear_codec_t* _pygear_lookup_codec(PyObject* serializer);
+
+/*
+ * The PYTHON_SERIALIZER module, imported once and shared by every object
+ * that hasn't been given its own serializer. Returns a new reference.
+ */
+PyObject* _pygear_default_serializer(void);
+
+/* Check that serializer is None or implements 'dumps' and 'loads' */
+int _pygear_check_serializer(PyObject* serializer);
+
+/*
+ * Shared argument parsing of set_serializer(serializer, typed_arrays=False)
+ * on Client, Worker, Task and Job. Fills in a borrowed, checked serializer
+ * and the typed_arrays flag; returns -1 with an exception set.
+ */
+int _pygear_parse_serializer(PyObject* args, PyObject* kwargs, PyObject** serializer, int* typed_arrays);
+
+/*
+ * Export the bytes of any object supporting the buffer protocol (str,
+ * bytearray, memoryview, mmap, array, ...) without copying them. Release
+ * the view with PyBuffer_Release once libgearman is done with the data.
+ */
+int _pygear_get_buffer(PyObject* obj, Py_buffer* view);
+
+/*
+ * Envelopes. Outside RAW mode, payloads that pygear handles itself are sent
+ * as PYGEAR_ENVELOPE_MAGIC followed by a one-byte kind flag. Text
+ * serializers never output a leading NUL, but binary ones might, which is
+ * why typed arrays are only recognized where they were turned on.
+ */
+#define PYGEAR_ENVELOPE_MAGIC "\0PG"
+#define PYGEAR_ENVELOPE_MAGIC_SIZE 3
+#define PYGEAR_ENVELOPE_HEADER_SIZE (PYGEAR_ENVELOPE_MAGIC_SIZE + 1)
+
+/*
+ * Typed numeric arrays, opted into with set_serializer(typed_arrays=True) on
+ * both ends. array.array instances and other objects exporting a contiguous
+ * one-dimensional buffer with a numeric format bypass the serializer. They
+ * are sent as an envelope, a one-byte element code from "bBhHiIqQfd" (struct
+ * module letters, standard sizes) and the little-endian elements. The
+ * receiving side turns them into an array.array with a single copy.
+ */
+#define PYGEAR_ENVELOPE_TYPED_ARRAY 'A'
+#define PYGEAR_TYPED_ARRAY_HEADER_SIZE (PYGEAR_ENVELOPE_HEADER_SIZE + 1)
+
+/*
+ * Compression. A serialized payload of at least threshold bytes is sent as
+ * an envelope, its size as a 4-byte little-endian integer and its zlib
+ * stream, provided that comes out smaller. Receivers always decompress, so
+ * only the sending side needs to be configured.
+ */
+#define PYGEAR_ENVELOPE_ZLIB 'Z'
+#define PYGEAR_ZLIB_HEADER_SIZE (PYGEAR_ENVELOPE_HEADER_SIZE + 4)
+
+/* Output buffer a received zlib stream starts inflating into, at least */
+#define PYGEAR_ZLIB_INITIAL_OUTPUT (64 * 1024)
+
+typedef struct {
+    Py_ssize_t threshold;   /* smallest payload to compress, -1 for never */
+    int level;              /* zlib level, 0-9 or -1 (Z_DEFAULT_COMPRESSION) */
+} pygear_compression_t;
+
+#define PYGEAR_COMPRESSION_OFF {-1, Z_DEFAULT_COMPRESSION}
+static const pygear_compression_t _pygear_compression_off = PYGEAR_COMPRESSION_OFF;
+
+/*
+ * Shared implementation of Client/Worker.set_compression(threshold, level,
+ * function). Updates defaults, or the (threshold, level) entry of
+ * function_map when a function name is given.
+ */
+PyObject* _pygear_set_compression(PyObject* args, PyObject* kwargs,
+    pygear_compression_t* defaults, PyObject* function_map);
+
+/* Settings for function: its entry in function_map if there is one, else defaults */
+void _pygear_compression_for(PyObject* function_map, const pygear_compression_t* defaults,
+    const char* function, pygear_compression_t* compression);
+
+/*
+ * Replace the serialized payload in view with its compressed envelope when
+ * compression asks for it; view is left alone in RAW mode. Returns -1 with
+ * an exception set, in which case view is still the uncompressed payload.
+ */
+int _pygear_compress(PyObject* serializer, const pygear_compression_t* compression, Py_buffer* view);
+
+/* Encode obj for transport into view, as a typed array envelope if it is one
+ * and typed_arrays is set; returns -1 with an exception set */
+int _pygear_serialize(PyObject* serializer, pygear_codec_t* codec, int typed_arrays, PyObject* obj,
+    Py_buffer* view);
+
+/* Decode size bytes at data, unpacking typed array envelopes only if
+ * typed_arrays is set; returns a new reference */
+PyObject* _pygear_deserialize(PyObject* serializer, pygear_codec_t* codec, int typed_arrays,
+    const char* data, Py_ssize_t size);
+
+#endif
@@ -6,7 +6,7 @@ pygear = Extension(
     "pygear",
     sources=["pygear.c"],
     runtime_library_dirs=["/usr/lib/"],  # libgearman7
-    extra_link_args=["-l:libgearman.so.7"],
+    extra_link_args=["-l:libgearman.so.7", "-lz"],
     extra_compile_args=["-I/usr/local/include", "-I/usr/include/python2.6/"]
 )
 
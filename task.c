@@ -33,36 +33,88 @@
  */
 
 int Task_init(pygear_TaskObject* self, PyObject* args, PyObject* kwds) {
-    self->serializer = PyImport_ImportModule(PYTHON_SERIALIZER);
+    self->serializer = _pygear_default_serializer();
+    self->codec = NULL;
+    self->typed_arrays = 0;
     if (self->serializer == NULL) {
-        PyObject* err_string = PyString_FromFormat("Failed to import '%s'", PYTHON_SERIALIZER);
-        PyErr_SetObject(PyExc_ImportError, err_string);
-        Py_XDECREF(err_string);
         return -1;
     }
     self->g_Task = NULL;
+    self->result = NULL;
     return 0;
 }
 
 int Task_traverse(pygear_TaskObject* self, visitproc visit, void* arg) {
     Py_VISIT(self->serializer);
+    Py_VISIT(self->result);
     return 0;
 }
 
 int Task_clear(pygear_TaskObject* self) {
     Py_CLEAR(self->serializer);
+    Py_CLEAR(self->result);
     return 0;
 }
 
+static pygear_TaskObject* _pygear_task_freelist[PYGEAR_TASK_FREELIST_MAX];
+static int _pygear_task_freelist_size = 0;
+static unsigned long _pygear_task_freelist_reused = 0;
+
 void Task_dealloc(pygear_TaskObject* self) {
+    PyObject_GC_UnTrack(self);
     if (self->g_Task) {
         gearman_task_free(self->g_Task);
         self->g_Task = NULL;
     }
     Task_clear(self);
+    if (Py_TYPE(self) == &pygear_TaskType && _pygear_task_freelist_size < PYGEAR_TASK_FREELIST_MAX) {
+        _pygear_task_freelist[_pygear_task_freelist_size++] = self;
+        return;
+    }
     self->ob_type->tp_free((PyObject*)self);
 }
 
+pygear_TaskObject* _pygear_task_new(PyObject* serializer, pygear_codec_t* codec, int typed_arrays,
+    gearman_task_st* g_Task) {
+    pygear_TaskObject* self;
+    if (_pygear_task_freelist_size > 0) {
+        // Fields were cleared by Task_dealloc, so only the refcount needs resetting
+        self = _pygear_task_freelist[--_pygear_task_freelist_size];
+        _Py_NewReference((PyObject*) self);
+        ++_pygear_task_freelist_reused;
+        PyObject_GC_Track(self);
+    } else {
+        self = (pygear_TaskObject*) pygear_TaskType.tp_alloc(&pygear_TaskType, 0);
+        if (!self) {
+            return NULL;
+        }
+    }
+    Py_INCREF(serializer);
+    self->serializer = serializer;
+    self->codec = codec;
+    self->typed_arrays = typed_arrays;
+    self->g_Task = g_Task;
+    return self;
+}
+
+PyObject* _pygear_task_take_result(gearman_task_st* g_Task) {
+    size_t taken_size;
+    void* taken_result = gearman_task_take_data(g_Task, &taken_size);
+    if (!taken_result) {
+        Py_RETURN_NONE;
+    }
+    return _pygear_result_new(taken_result, taken_size);
+}
+
+PyObject* _pygear_task_freelist_stats(void) {
+    return Py_BuildValue(
+        "{s:i, s:i, s:k}",
+        "size", _pygear_task_freelist_size,
+        "max", PYGEAR_TASK_FREELIST_MAX,
+        "reused", _pygear_task_freelist_reused
+    );
+}
+
 /*
  * Callback handling
  */
@@ -111,41 +163,58 @@ static PyObject* pygear_task_data_size(pygear_TaskObject* self) {
     return Py_BuildValue("I", gearman_task_data_size(self->g_Task));
 }
 
-static PyObject* pygear_task_set_serializer(pygear_TaskObject* self, PyObject* args) {
+static PyObject* pygear_task_set_serializer(pygear_TaskObject* self, PyObject* args, PyObject* kwargs) {
     PyObject* serializer;
-    if (!PyArg_ParseTuple(args, "O", &serializer)) {
-        return NULL;
-    }
-    if (!PyObject_HasAttrString(serializer, "loads")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'loads'");
-        return NULL;
-    }
-    if (!PyObject_HasAttrString(serializer, "dumps")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'dumps'");
+    int typed_arrays;
+    if (_pygear_parse_serializer(args, kwargs, &serializer, &typed_arrays) == -1) {
         return NULL;
     }
     Py_INCREF(serializer);
     Py_XDECREF(self->serializer);
     self->serializer = serializer;
+    self->codec = _pygear_lookup_codec(serializer);
+    self->typed_arrays = typed_arrays;
+    // Anything decoded with the previous serializer is stale now
+    if (self->result && !PyObject_TypeCheck(self->result, &pygear_ResultType)) {
+        Py_CLEAR(self->result);
+    }
     Py_RETURN_NONE;
 }
 
-static PyObject* pygear_task_result(pygear_TaskObject* self) {
+static PyObject* pygear_task_result(pygear_TaskObject* self, PyObject* args, PyObject* kwargs) {
+    PyObject* cache = Py_True;
+    static char* kwlist[] = {"cache", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &cache)) {
+        return NULL;
+    }
+    int use_cache = PyObject_IsTrue(cache);
+    if (use_cache == -1) {
+        return NULL;
+    }
+    // A RAW Result is immutable and owns data taken from the task, so it is
+    // always handed back from the cache
+    if (self->result && (use_cache || PyObject_TypeCheck(self->result, &pygear_ResultType))) {
+        Py_INCREF(self->result);
+        return self->result;
+    }
+    if (PYGEAR_IS_RAW(self->serializer)) {
+        self->result = _pygear_task_take_result(self->g_Task);
+        Py_XINCREF(self->result);
+        return self->result;
+    }
     const char* task_result = gearman_task_data(self->g_Task);
     size_t result_size = gearman_task_data_size(self->g_Task);
     if (!task_result) {
         Py_RETURN_NONE;
     }
-    PyObject* py_result = Py_BuildValue("s#", task_result, result_size);
-    if (!py_result) {
-        PyErr_SetString(PyExc_SystemError, "Failed to build value from Task result\n");
-        return NULL;
-    }
-    PyObject* unpickled_result = PyObject_CallMethod(self->serializer, "loads", "O", py_result);
-    Py_XDECREF(py_result);
+    PyObject* unpickled_result = _pygear_deserialize(self->serializer, self->codec, self->typed_arrays, task_result, result_size);
     if (!unpickled_result) {
         PyErr_SetString(PyExc_SystemError," Failed to unpickle internal Task data\n");
         return NULL;
     }
+    if (use_cache) {
+        Py_INCREF(unpickled_result);
+        self->result = unpickled_result;
+    }
     return unpickled_result;
 }
@@ -30,6 +30,8 @@
 #include <libgearman-1.0/gearman.h>
 #include <stdio.h>
 #include "structmember.h"
+#include "serializer.h"
+#include "result.h"
 
 #ifndef PyMODINIT_FUNC
 #define PyMODINIT_FUNC void
@@ -38,12 +40,18 @@
 #ifndef TASK_H
 #define TASK_H
 
+/* Wrappers kept around for reuse by _pygear_task_new */
+#define PYGEAR_TASK_FREELIST_MAX 64
+
 #define _TASKMETHOD(name,flags) {#name,(PyCFunction) pygear_task_##name,flags,pygear_task_##name##_doc},
 
 typedef struct {
     PyObject_HEAD
     struct gearman_task_st* g_Task;
+    PyObject* result;   /* decoded result, or the RAW result taken from libgearman */
     PyObject* serializer;
+    pygear_codec_t* codec;      /* native codec of serializer, borrowed */
+    int typed_arrays;           /* set_serializer(typed_arrays=...) */
 } pygear_TaskObject;
 
 PyDoc_STRVAR(task_module_docstring, "Represents a Gearman task");
@@ -54,6 +62,18 @@ int Task_traverse(pygear_TaskObject *self,  visitproc visit, void *arg);
 int Task_clear(pygear_TaskObject* self);
 void Task_dealloc(pygear_TaskObject* self);
 
+/* Build a Task from C without going through tp_init or set_serializer */
+pygear_TaskObject* _pygear_task_new(PyObject* serializer, pygear_codec_t* codec, int typed_arrays,
+    gearman_task_st* g_Task);
+
+/* Take the data of g_Task over into a pygear.Result (None if there is none).
+ * Only the first call gets the data, so RAW results are taken once and the
+ * Result shared. Returns a new reference, NULL with an exception set. */
+PyObject* _pygear_task_take_result(gearman_task_st* g_Task);
+
+/* Freelist counters for pygear.freelist_stats() */
+PyObject* _pygear_task_freelist_stats(void);
+
 /* Method definitions */
 static PyObject* pygear_task_function_name(pygear_TaskObject* self);
 PyDoc_STRVAR(pygear_task_function_name_doc,
@@ -95,23 +115,32 @@ static PyObject* pygear_task_strstate(pygear_TaskObject* self);
 PyDoc_STRVAR(pygear_task_strstate_doc,
 "Get a string representation of the state of a task.");
 
-static PyObject* pygear_task_result(pygear_TaskObject* self);
+static PyObject* pygear_task_result(pygear_TaskObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_task_result_doc,
-"Get the data returned by a completed task as a string");
+"Get the data returned by a completed task, decoded by the serializer.\n"
+"The decoded object is cached, so later calls return the same object\n"
+"without running 'loads' again.\n"
+"In RAW mode this is a pygear.Result that takes over the buffer libgearman\n"
+"received, without copying it.\n"
+"@param[in] cache - Pass False to get a freshly decoded object that is not\n"
+"\tcached, e.g. when the caller is going to mutate it.");
 
 static PyObject* pygear_task_data_size(pygear_TaskObject* self);
 PyDoc_STRVAR(pygear_task_data_size_doc,
 "Get the size of the data for a completed task in bytes");
 
-static PyObject* pygear_task_set_serializer(pygear_TaskObject* self, PyObject* args);
+static PyObject* pygear_task_set_serializer(pygear_TaskObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_task_set_serializer_doc,
 "Specify the object to be used to serialize data passed through gearman.\n"
 "By default, pygear will use 'json' to convert data to a string\n"
 "representation during transit and reconstitute it on the other end.\n"
 "You can replace the serializer with your own as long as it implements\n"
 "the 'dumps' and 'loads' methods. 'dumps' must return a string, and loads\n"
-"must take a string.\n"
-"@param[in] serializer Object implementing dumps and loads");
+"must take a string. Pass None (pygear.RAW) to skip serialization and\n"
+"send and receive plain strings.\n"
+"@param[in] serializer Object implementing dumps and loads, or None\n"
+"@param[in] typed_arrays Exchange numeric arrays as raw elements; see\n"
+"\tClient.set_serializer");
 
 /* Module method specification */
 static PyMethodDef task_module_methods[] = {
@@ -125,9 +154,9 @@ static PyMethodDef task_module_methods[] = {
     _TASKMETHOD(error, METH_NOARGS)
     _TASKMETHOD(returncode, METH_NOARGS)
     _TASKMETHOD(strstate, METH_NOARGS)
-    _TASKMETHOD(result, METH_NOARGS)
+    _TASKMETHOD(result, METH_VARARGS | METH_KEYWORDS)
     _TASKMETHOD(data_size, METH_NOARGS)
-    _TASKMETHOD(set_serializer, METH_VARARGS)
+    _TASKMETHOD(set_serializer, METH_VARARGS | METH_KEYWORDS)
     {NULL, NULL, 0, NULL}
 };
 
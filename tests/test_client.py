@@ -37,6 +37,34 @@ def test_client_add_task(c):
 # add_task_high_background(...)
 
 
+def test_client_add_tasks(c):
+    assert c.add_tasks('reverse', ['a', 'b', 'c']) == 3
+    assert c.add_tasks('reverse', (str(i) for i in range(10)), background=True) == 10
+    assert c.add_tasks('reverse', ['a', 'b'], uniques=['u1', None], priority=pygear.PYGEAR_PRIORITY_HIGH) == 2
+    assert c.add_tasks('reverse', []) == 0
+    with pytest.raises(ValueError):
+        c.add_tasks('reverse', ['a', 'b'], uniques=['u1'])
+    with pytest.raises(ValueError):
+        c.add_tasks('reverse', ['a'], priority=42)
+
+
+def test_client_add_tasks_failure_queues_nothing(c):
+    c.add_task('reverse', 'queued before')
+    with pytest.raises(TypeError):
+        c.add_tasks('reverse', ['a', 'b', object()])
+    # Only the task queued before is left to submit
+    with pytest.raises(pygear.NO_SERVERS):
+        c.step()
+    assert c.step() is True
+
+
+def test_client_do_background_many_without_servers(c):
+    with pytest.raises(pygear.NO_SERVERS):
+        c.do_background_many('reverse', ['a', 'b'])
+    with pytest.raises(ValueError):
+        c.do_background_many('reverse', ['a'], uniques=[])
+
+
 def test_client_add_task_status(c):
     pass
 
@@ -86,6 +114,9 @@ def test_client_execute(c):
     # execute without server
     with pytest.raises(pygear.UNKNOWN_STATE):
         c.execute("reverse", "Jackdaws love my big sphynx of quartz")
+    # unicode workloads are encoded rather than rejected
+    with pytest.raises(pygear.UNKNOWN_STATE):
+        c.execute("reverse", u"Jackdaws love my big sphynx of quartz")
 
 
 def test_client_get_options(c):
@@ -111,6 +142,36 @@ def test_client_run_tasks(c):
         c.run_tasks()
 
 
+def test_client_fileno(c):
+    fd = c.fileno()
+    assert isinstance(fd, int)
+    assert c.fileno() == fd
+
+
+def test_client_clone_fileno(c):
+    cl = c.clone()
+    del c
+    assert isinstance(cl.fileno(), int)
+    assert cl.step() is True
+
+
+def test_client_step(c):
+    assert c.step() is True
+    c.add_task("reverse", "A string")
+    with pytest.raises(pygear.NO_SERVERS):
+        c.step()
+
+
+def test_client_run_tasks_max_in_flight(c):
+    with pytest.raises(ValueError):
+        c.run_tasks(max_in_flight=0)
+    with pytest.raises(TypeError):
+        c.run_tasks(max_in_flight=1.5)
+    c.add_tasks("reverse", ["a", "b", "c"])
+    with pytest.raises(pygear.NO_SERVERS):
+        c.run_tasks(max_in_flight=2)
+
+
 def test_client_set_log_fn(c):
     pass
 
@@ -123,6 +184,26 @@ def test_client_set_serializer(c):
     c.set_serializer(noop_serializer())  # valid
     with pytest.raises(AttributeError):  # invalid
         c.set_serializer("a string doesn't implement loads.")
+    c.set_serializer(pygear.RAW)  # None disables serialization
+
+
+def test_client_raw_rejects_non_string(c):
+    c.set_serializer(pygear.RAW)
+    with pytest.raises(TypeError):
+        c.add_task("test_raw", {"not": "bytes"})
+    with pytest.raises(TypeError):
+        c.add_task("test_raw", u"unicode is not bytes")
+
+
+def test_client_set_compression(c):
+    c.set_compression(1024)
+    c.set_compression(0, level=9, function='resize')
+    c.set_compression(None, function='thumbnail')
+    c.set_compression(None)
+    with pytest.raises(ValueError):
+        c.set_compression(-1)
+    with pytest.raises(ValueError):
+        c.set_compression(1024, level=10)
 
 
 def test_client_set_status_fn(c):
@@ -147,6 +228,13 @@ def test_client_unique_status(c):
     pass
 
 
+def test_client_status_many_rejects_non_strings(c):
+    with pytest.raises(TypeError):
+        c.job_status_many([1, 2])
+    with pytest.raises(TypeError):
+        c.unique_status_many(None)
+
+
 def test_client_wait(c):
     pass
 
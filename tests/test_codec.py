@@ -0,0 +1,68 @@
+import pytest
+import pygear
+
+
+PAYLOAD = {'name': 'job', 'ids': [1, 2, 3], 'score': 0.5, 'ok': True, 'none': None}
+
+
+def test_codec_not_instantiable():
+    with pytest.raises(TypeError):
+        pygear.Codec()
+
+
+def test_codec_roundtrip():
+    encoded = pygear.MSGPACK.dumps(PAYLOAD)
+    assert type(encoded) is str
+    assert pygear.MSGPACK.loads(encoded) == PAYLOAD
+    assert pygear.MSGPACK.loads(bytearray(encoded)) == PAYLOAD
+
+
+def test_codec_exports_capsule():
+    assert isinstance(pygear.MSGPACK, pygear.Codec)
+    assert type(pygear.MSGPACK._pygear_codec).__name__ == 'PyCapsule'
+
+
+def test_codec_accepted_as_serializer():
+    pygear.Client().set_serializer(pygear.MSGPACK)
+    pygear.Worker().set_serializer(pygear.MSGPACK)
+    pygear.Task(None, None).set_serializer(pygear.MSGPACK)
+    pygear.Job().set_serializer(pygear.MSGPACK)
+
+
+@pytest.mark.parametrize('value', [
+    None, True, False, 0, 127, 128, 65536, 2 ** 63 - 1, 2 ** 64 - 1,
+    -1, -32, -33, -2 ** 31 - 1, -2 ** 63, 0.5, '', 'x' * 300, '\x00\xff',
+    u'', u'h\xe9llo', u'y' * 70000, [], [1, [2, [3]]], range(70000), {},
+    {u'a': 1, 'b': [None, 1.5]},
+])
+def test_msgpack_roundtrip(value):
+    decoded = pygear.MSGPACK.loads(pygear.MSGPACK.dumps(value))
+    assert decoded == value
+    assert type(decoded) in (type(value), int, long)
+
+
+def test_msgpack_wire_format():
+    assert pygear.MSGPACK.dumps(1) == '\x01'
+    assert pygear.MSGPACK.dumps(-1) == '\xff'
+    assert pygear.MSGPACK.dumps(u'a') == '\xa1a'
+    assert pygear.MSGPACK.dumps('a') == '\xc4\x01a'
+    assert pygear.MSGPACK.dumps([None, True]) == '\x92\xc0\xc3'
+    assert pygear.MSGPACK.loads('\xca\x3f\xc0\x00\x00') == 1.5
+    assert pygear.MSGPACK.loads(pygear.MSGPACK.dumps((1, 2))) == [1, 2]
+
+
+@pytest.mark.parametrize('data', ['', '\xc1', '\x92\x01', '\x01\x02', '\xdd\xff\xff\xff\xff', '\xd9\x05ab'])
+def test_msgpack_invalid_payload(data):
+    with pytest.raises(ValueError):
+        pygear.MSGPACK.loads(data)
+
+
+def test_msgpack_unsupported_values():
+    with pytest.raises(TypeError):
+        pygear.MSGPACK.dumps(object())
+    with pytest.raises(OverflowError):
+        pygear.MSGPACK.dumps(2 ** 64)
+    recursive = []
+    recursive.append(recursive)
+    with pytest.raises(RuntimeError):
+        pygear.MSGPACK.dumps(recursive)
@@ -0,0 +1,73 @@
+import gc
+
+import pytest
+import pygear
+
+
+@pytest.fixture
+def c():
+    return pygear.Client()
+
+
+def test_future_not_constructible():
+    with pytest.raises(TypeError):
+        pygear.Future()
+
+
+def test_future_pending(c):
+    f = c.submit('reverse', 'A string to be reversed')
+    assert type(f) == pygear.Future
+    assert not f.done()
+
+
+def test_future_result_without_server(c):
+    f = c.submit('reverse', 'A string to be reversed')
+    with pytest.raises(pygear.NO_SERVERS):
+        f.result()
+
+
+def test_future_timeout_argument(c):
+    f = c.submit('reverse', 'A string to be reversed')
+    with pytest.raises(ValueError):
+        f.result(timeout=-1)
+    with pytest.raises(TypeError):
+        f.exception(timeout='soon')
+
+
+def test_future_invalid_priority(c):
+    with pytest.raises(ValueError):
+        c.submit('reverse', 'A string', priority=42)
+
+
+def test_as_completed_empty(c):
+    assert list(c.as_completed([])) == []
+
+
+def test_as_completed_type_checks(c):
+    with pytest.raises(TypeError):
+        c.as_completed(['not a future'])
+    with pytest.raises(TypeError):
+        c.as_completed(None)
+
+
+def test_as_completed_other_client(c):
+    f = pygear.Client().submit('reverse', 'A string')
+    with pytest.raises(ValueError):
+        c.as_completed([f])
+
+
+def test_as_completed_single_waiter(c):
+    f = c.submit('reverse', 'A string')
+    it = c.as_completed([f, f])
+    with pytest.raises(ValueError):
+        c.as_completed([f])
+    del it
+    gc.collect()
+    c.as_completed([f])
+
+
+def test_future_client_cycle_collected():
+    client = pygear.Client()
+    client.submit('reverse', 'A string')
+    del client
+    assert gc.collect() > 0
@@ -1,8 +1,15 @@
+import array
+import json
 import mock
 import multiprocessing
 import pytest
 import pygear
+import select
+import signal
 import sys
+import threading
+import time
+import zlib
 
 from . import TEST_SERVER_HOST
 from . import TEST_SERVER_PORT
@@ -73,6 +80,48 @@ def test_client_do_background(c):
     worker_thread.join()
 
 
+SLEEP_SECONDS = 0.5
+
+
+def sleep_function(job):
+    time.sleep(SLEEP_SECONDS)
+    return job.workload()
+
+
+def thread_worker_sleep():
+    worker = w()
+    worker.add_function("test_integration_sleep", 0, sleep_function)
+    try:
+        while True:
+            worker.work()
+    except pygear.TIMEOUT:
+        pass
+
+
+def test_client_do_threads_in_parallel():
+    results = []
+
+    def thread_do():
+        results.append(c().do("test_integration_sleep", "Test string!"))
+
+    # One worker per call, so the jobs themselves can run side by side
+    workers = [multiprocessing.Process(target=thread_worker_sleep) for _ in range(4)]
+    for worker in workers:
+        worker.start()
+    threads = [threading.Thread(target=thread_do) for _ in range(4)]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - start
+    for worker in workers:
+        worker.join()
+    assert results == ["Test string!"] * 4
+    # Waiting calls that held the GIL would take turns, one sleep each
+    assert elapsed < 2 * SLEEP_SECONDS
+
+
 def test_client_clear_fn(c):
     cb_test = mock.Mock()
     c.set_complete_fn(cb_test)
@@ -96,6 +145,219 @@ def test_client_set_complete_fn(c):
     assert cb_test.called
 
 
+def test_client_add_tasks(c):
+    results = []
+    c.set_complete_fn(lambda task: results.append(task.result()))
+    c.add_tasks("test_integration_echo", ["Some string %d" % i for i in range(50)])
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    c.run_tasks()
+    worker_thread.join()
+    assert sorted(results) == sorted("Some string %d" % i for i in range(50))
+
+
+def test_client_run_tasks_max_in_flight(c):
+    results = []
+    c.set_complete_fn(lambda task: results.append(task.result()))
+    c.add_tasks("test_integration_echo", ["Some string %d" % i for i in range(50)])
+    c.add_task("test_integration_echo", "One more")
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    c.run_tasks(max_in_flight=4)
+    worker_thread.join()
+    assert sorted(results) == sorted(["One more"] + ["Some string %d" % i for i in range(50)])
+
+
+def test_client_submit_as_completed(c):
+    futures = [c.submit("test_integration_echo", "Some string %d" % i) for i in range(20)]
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    results = [future.result() for future in c.as_completed(futures)]
+    worker_thread.join()
+    assert sorted(results) == sorted("Some string %d" % i for i in range(20))
+    assert all(future.done() for future in futures)
+
+
+def test_client_submit_fail(c):
+    future = c.submit("test_integration_fail", "Some string")
+    worker_thread = multiprocessing.Process(target=thread_worker_fail)
+    worker_thread.start()
+    with pytest.raises(pygear.WORK_FAIL):
+        future.result()
+    worker_thread.join()
+    assert isinstance(future.exception(), pygear.WORK_FAIL)
+
+
+def test_client_worker_step_select(c, w):
+    futures = [c.submit("test_integration_echo", "Some string %d" % i) for i in range(10)]
+    w.add_function("test_integration_echo", 0, echo_function)
+    fds = {c.fileno(): c, w.fileno(): w}
+    w.step()
+    done = c.step()
+    while not done:
+        readable, _, _ = select.select(list(fds), [], [], TEST_TIMEOUT_MSEC / 1000.0)
+        assert readable
+        for fd in readable:
+            if fds[fd] is c:
+                done = c.step()
+            else:
+                w.step()
+    assert sorted(f.result() for f in futures) == sorted("Some string %d" % i for i in range(10))
+
+
+def test_poll_client_worker(c, w):
+    futures = [c.submit("test_integration_echo", "Some string %d" % i) for i in range(10)]
+    w.add_function("test_integration_echo", 0, echo_function)
+    w.step()
+    done = c.step()
+    while not done:
+        ready = pygear.poll([c, w], TEST_TIMEOUT_MSEC / 1000.0)
+        assert ready
+        if w in ready:
+            w.step()
+        if c in ready:
+            done = c.step()
+    assert sorted(f.result() for f in futures) == sorted("Some string %d" % i for i in range(10))
+
+
+def select_wait_hook(calls):
+    def hook(fd, timeout):
+        calls.append((fd, timeout))
+        select.select([fd], [], [], timeout)
+    return hook
+
+
+def test_wait_hook_client_do(c):
+    calls = []
+    pygear.set_wait_hook(select_wait_hook(calls))
+    try:
+        worker_thread = multiprocessing.Process(target=thread_worker_echo)
+        worker_thread.start()
+        assert c.do("test_integration_echo", "Test string!") == "Test string!"
+        worker_thread.join()
+    finally:
+        pygear.set_wait_hook(None)
+    # do() waits for the job through the hook, on the client's descriptor
+    assert calls
+    assert all(call == (c.fileno(), TEST_TIMEOUT_MSEC / 1000.0) for call in calls)
+
+
+def test_wait_hook_worker_work(w):
+    calls = []
+    w.add_function("test_integration_echo", 0, echo_function)
+    client_thread = multiprocessing.Process(target=thread_client_echo, args=(False,))
+    client_thread.start()
+    pygear.set_wait_hook(select_wait_hook(calls))
+    try:
+        w.work()
+    finally:
+        pygear.set_wait_hook(None)
+    client_thread.join()
+    assert client_thread.exitcode == 0
+    assert calls
+    assert all(fd == w.fileno() for fd, _ in calls)
+
+
+def test_wait_hook_raises(c):
+    def hook(fd, timeout):
+        raise TestError()
+    future = c.submit("test_integration_nobody", "Some string")
+    pygear.set_wait_hook(hook)
+    try:
+        with pytest.raises(TestError):
+            future.result()
+    finally:
+        pygear.set_wait_hook(None)
+
+
+def raise_after_alarm(fn, seconds):
+    def handler(signum, frame):
+        raise TestError()
+    previous = signal.signal(signal.SIGALRM, handler)
+    signal.setitimer(signal.ITIMER_REAL, seconds)
+    start = time.time()
+    try:
+        with pytest.raises(TestError):
+            fn()
+    finally:
+        signal.setitimer(signal.ITIMER_REAL, 0)
+        signal.signal(signal.SIGALRM, previous)
+    return time.time() - start
+
+
+def test_worker_work_signal(w):
+    w.add_function("test_integration_idle", 0, echo_function)
+    assert raise_after_alarm(w.work, 0.2) < TEST_TIMEOUT_MSEC / 2000.0
+
+
+def test_client_do_signal(c):
+    assert raise_after_alarm(lambda: c.do("test_integration_nobody", "Some string"), 0.2) < TEST_TIMEOUT_MSEC / 2000.0
+    # The interrupted job is dropped and the client still usable
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    assert c.do("test_integration_echo", "Test string!") == "Test string!"
+    worker_thread.join()
+
+
+def test_client_run_tasks_signal(c):
+    c.add_task("test_integration_nobody", "Some string")
+    assert raise_after_alarm(c.run_tasks, 0.2) < TEST_TIMEOUT_MSEC / 2000.0
+
+
+def test_client_do_background_many(c):
+    created = mock.Mock()
+    c.set_created_fn(created)
+    handles = c.do_background_many("test_integration_echo", ["Some string %d" % i for i in range(20)])
+    assert len(handles) == 20
+    assert len(set(handles)) == 20
+    assert all(h.startswith("H:") for h in handles)
+    assert not created.called
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    worker_thread.join()
+
+
+def test_client_do_background_many_non_blocking(c):
+    c.set_options(non_blocking=True)
+    handles = c.do_background_many("test_integration_echo", ["Some string %d" % i for i in range(5)])
+    assert all(h.startswith("H:") for h in handles)
+    statuses = c.job_status_many(handles)
+    assert all(statuses[h]["is_known"] for h in handles)
+    assert c.get_options()["non_blocking"]
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    worker_thread.join()
+
+
+def test_client_free_tasks(c):
+    c.set_options(free_tasks=True)
+    results = []
+    c.set_complete_fn(lambda task: results.append(task.result()))
+    c.add_tasks("test_integration_echo", ["Some string %d" % i for i in range(10)])
+    futures = [c.submit("test_integration_echo", "Future %d" % i) for i in range(10)]
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    c.run_tasks(max_in_flight=4)
+    assert [future.result() for future in futures] == ["Future %d" % i for i in range(10)]
+    worker_thread.join()
+    assert sorted(results) == sorted(["Some string %d" % i for i in range(10)] +
+                                     ["Future %d" % i for i in range(10)])
+    assert c.get_options()["free_tasks"]
+
+
+def test_client_job_status_many(c):
+    handles = c.do_background_many("test_integration_echo", ["Some string %d" % i for i in range(20)])
+    statuses = c.job_status_many(handles + ["H:unknown:0"])
+    assert set(statuses) == set(handles + ["H:unknown:0"])
+    assert all(statuses[h]["is_known"] for h in handles)
+    assert statuses["H:unknown:0"]["is_known"] is False
+    assert statuses["H:unknown:0"] == c.job_status("H:unknown:0")
+    worker_thread = multiprocessing.Process(target=thread_worker_echo)
+    worker_thread.start()
+    worker_thread.join()
+    assert not any(status["is_known"] for status in c.job_status_many(handles).values())
+
+
 def test_client_set_created_fn(c):
     cb_test = mock.Mock()
     c.set_created_fn(cb_test)
@@ -218,3 +480,160 @@ def test_change_serializer(c):
     c.add_task("test_integration_serializer", "Woof")
     c.run_tasks()
     worker_thread.join()
+
+
+RAW_PAYLOAD = "\x00\xffnot json\x80"
+
+
+def thread_worker_raw():
+    def worker_fn_raw(job):
+        assert job.workload() == RAW_PAYLOAD
+        return job.workload()[::-1]
+
+    worker = w()
+    worker.set_serializer(pygear.RAW)
+    worker.add_function("test_integration_raw", 0, worker_fn_raw)
+    try:
+        while True:
+            worker.work()
+    except pygear.TIMEOUT:
+        pass
+
+
+def test_raw_serializer(c):
+    c.set_serializer(pygear.RAW)
+    worker_thread = multiprocessing.Process(target=thread_worker_raw)
+    worker_thread.start()
+    result = c.do("test_integration_raw", RAW_PAYLOAD)
+    assert isinstance(result, pygear.Result)
+    assert result == RAW_PAYLOAD[::-1]
+    assert str(result) == RAW_PAYLOAD[::-1]
+    assert len(result) == len(RAW_PAYLOAD)
+    assert memoryview(result).tobytes() == RAW_PAYLOAD[::-1]
+    # Hashes like the equal str, so it works as a dict key or set member
+    assert hash(result) == hash(RAW_PAYLOAD[::-1])
+    assert {RAW_PAYLOAD[::-1]: "found"}[result] == "found"
+    assert result in set([RAW_PAYLOAD[::-1]])
+    assert c.do("test_integration_raw", bytearray(RAW_PAYLOAD)) == RAW_PAYLOAD[::-1]
+    assert c.do("test_integration_raw", memoryview(RAW_PAYLOAD)) == RAW_PAYLOAD[::-1]
+    worker_thread.join()
+
+
+def test_raw_serializer_submit_with_callback(c):
+    c.set_serializer(pygear.RAW)
+    results = []
+    c.set_complete_fn(lambda task: results.append(task.result()))
+    future = c.submit("test_integration_raw", RAW_PAYLOAD)
+    worker_thread = multiprocessing.Process(target=thread_worker_raw)
+    worker_thread.start()
+    assert future.result() == RAW_PAYLOAD[::-1]
+    worker_thread.join()
+    assert results == [RAW_PAYLOAD[::-1]]
+    assert results[0] is future.result()
+
+
+def thread_worker_msgpack():
+    worker = w()
+    worker.set_serializer(pygear.MSGPACK)
+    worker.add_function("test_integration_msgpack", 0, echo_function)
+    try:
+        while True:
+            worker.work()
+    except pygear.TIMEOUT:
+        pass
+
+
+def test_native_codec(c):
+    payload = {'ids': [1, 2, 3], 'blob': '\x00\xff', 'score': 0.25}
+    c.set_serializer(pygear.MSGPACK)
+    worker_thread = multiprocessing.Process(target=thread_worker_msgpack)
+    worker_thread.start()
+    assert c.do("test_integration_msgpack", payload) == payload
+    worker_thread.join()
+
+
+RESIZE_SCHEMA = pygear.Schema({'url': unicode, 'width': int, 'height': int, 'crop': bool})
+
+
+def thread_worker_schema():
+    worker = w()
+    worker.add_function("test_integration_schema", 0, echo_function, schema=RESIZE_SCHEMA)
+    try:
+        while True:
+            worker.work()
+    except pygear.TIMEOUT:
+        pass
+
+
+def test_schema(c):
+    payload = {'url': u'http://example.com/a.png', 'width': 64, 'height': 48}
+    worker_thread = multiprocessing.Process(target=thread_worker_schema)
+    worker_thread.start()
+    # The workload goes out with the schema, the echoed result with json
+    result = c.do("test_integration_schema", payload, schema=RESIZE_SCHEMA)
+    assert result == dict(payload, crop=None)
+    worker_thread.join()
+
+
+def thread_worker_typed_array():
+    worker = w()
+    worker.set_serializer(json, typed_arrays=True)
+    worker.add_function("test_integration_typed_array", 0, echo_function)
+    try:
+        while True:
+            worker.work()
+    except pygear.TIMEOUT:
+        pass
+
+
+def test_typed_array(c):
+    c.set_serializer(json, typed_arrays=True)
+    worker_thread = multiprocessing.Process(target=thread_worker_typed_array)
+    worker_thread.start()
+    vector = array.array('d', [i * 0.5 for i in range(1000)])
+    result = c.do("test_integration_typed_array", vector)
+    assert isinstance(result, array.array)
+    assert result.typecode == 'd'
+    assert result == vector
+    counts = array.array('H', [1, 2, 65535])
+    assert c.do("test_integration_typed_array", counts) == counts
+    worker_thread.join()
+
+
+def test_typed_array_off_by_default(c):
+    # Without typed_arrays the serializer sees the array as it always did
+    with pytest.raises(TypeError):
+        c.do("test_integration_typed_array", array.array('d', [0.5]))
+
+
+def thread_worker_compressed():
+    worker = w()
+    worker.set_compression(1024)
+    worker.add_function("test_integration_compressed", 0, echo_function)
+    try:
+        while True:
+            worker.work()
+    except pygear.TIMEOUT:
+        pass
+
+
+def test_compression(c):
+    payload = {'text': u'lorem ipsum dolor sit amet ' * 1000}
+    c.set_compression(1024, function="test_integration_compressed")
+    worker_thread = multiprocessing.Process(target=thread_worker_compressed)
+    worker_thread.start()
+    # Both the workload and the echoed result cross the wire compressed
+    assert c.do("test_integration_compressed", payload) == payload
+    assert c.do("test_integration_compressed", {'small': 1}) == {'small': 1}
+    worker_thread.join()
+
+
+def test_compression_rejects_oversized_header(c):
+    # A tiny zlib stream claiming to inflate to 4 GiB is refused, not allocated
+    envelope = '\x00PGZ\xff\xff\xff\xff' + zlib.compress('"x"')
+    c.set_serializer(pygear.RAW)
+    worker_thread = multiprocessing.Process(target=thread_worker_compressed)
+    worker_thread.start()
+    with pytest.raises((pygear.WORK_EXCEPTION, pygear.WORK_FAIL)):
+        c.do("test_integration_compressed", envelope)
+    worker_thread.join()
@@ -1,4 +1,5 @@
 import gc
+import json
 import multiprocessing
 
 import mock
@@ -40,7 +41,16 @@ def job_test_function(job):
     assert job.function_name() == TEST_FUNCTION_NAME
     assert job.unique() == TEST_UNIQUE
     assert job.workload() == TEST_WORKLOAD
+    assert job.workload() is job.workload()
+    assert job.workload(cache=False) is not job.workload()
     assert job.workload_size() == len(TEST_WORKLOAD)
+    view = job.workload_view()
+    assert view.readonly
+    assert view.tobytes() == json.dumps(TEST_WORKLOAD)
+    retained_views.append(view)
+
+
+retained_views = []
 
 
 def thread_worker():
@@ -51,6 +61,9 @@ def thread_worker():
             worker.work()
     except pygear.TIMEOUT:
         pass
+    # Views outlive the job function that created them
+    for view in retained_views:
+        assert view.tobytes() == json.dumps(TEST_WORKLOAD)
 
 
 def test_job_methods(c):
@@ -66,3 +79,8 @@ def test_gc_traversal():
     sentinel = mock.Mock()
     j.set_serializer(sentinel)
     assert sentinel in gc.get_referents(j)
+
+
+def test_workload_view_without_job():
+    with pytest.raises(ValueError):
+        pygear.Job().workload_view()
@@ -0,0 +1,69 @@
+import json
+import pytest
+import pygear
+
+
+SCHEMA = pygear.Schema({
+    'id': int,
+    'name': unicode,
+    'score': float,
+    'active': bool,
+    'blob': str,
+    'extra': object,
+})
+
+PAYLOAD = {
+    'id': -5,
+    'name': u'h\xe9llo',
+    'score': 2.5,
+    'active': True,
+    'blob': '\x00\xff',
+    'extra': [1, {u'a': None}],
+}
+
+
+def test_schema_is_codec():
+    assert isinstance(SCHEMA, pygear.Codec)
+    assert SCHEMA.fields == ('active', 'blob', 'extra', 'id', 'name', 'score')
+
+
+def test_schema_roundtrip():
+    encoded = SCHEMA.dumps(PAYLOAD)
+    assert SCHEMA.loads(encoded) == PAYLOAD
+    assert len(encoded) < len(pygear.MSGPACK.dumps(PAYLOAD)) < len(json.dumps(PAYLOAD))
+
+
+def test_schema_missing_fields_decode_to_none():
+    decoded = SCHEMA.loads(SCHEMA.dumps({'id': 1, 'name': None}))
+    assert decoded == dict(dict.fromkeys(SCHEMA.fields), id=1)
+
+
+@pytest.mark.parametrize(('payload', 'exception'), [
+    ({'unknown': 1}, ValueError),
+    ({'id': 'x'}, TypeError),
+    ({'active': 1}, TypeError),
+    ([], TypeError),
+])
+def test_schema_rejects_mismatched_payload(payload, exception):
+    with pytest.raises(exception):
+        SCHEMA.dumps(payload)
+
+
+def test_schema_rejects_foreign_payload():
+    encoded = SCHEMA.dumps(PAYLOAD)
+    for data in [encoded[:-1], encoded + 'x', pygear.Schema({'id': int}).dumps({'id': 1})]:
+        with pytest.raises(ValueError):
+            SCHEMA.loads(data)
+
+
+@pytest.mark.parametrize('spec', [{'a': dict}, {1: int}])
+def test_schema_invalid_spec(spec):
+    with pytest.raises(TypeError):
+        pygear.Schema(spec)
+
+
+def test_schema_accepted_by_add_function():
+    w = pygear.Worker()
+    w.add_function('resize', 0, lambda job: None, schema=SCHEMA)
+    with pytest.raises(TypeError):
+        w.add_function('resize', 0, lambda job: None, schema=pygear.MSGPACK)
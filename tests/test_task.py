@@ -1,4 +1,5 @@
 import gc
+import json
 
 import mock
 import pytest
@@ -48,6 +49,15 @@ def test_task_result(t):
     assert t.result() is None
 
 
+def test_task_result_no_cache(t):
+    assert t.result(cache=False) is None
+
+
+def test_task_result_raw(t):
+    t.set_serializer(pygear.RAW)
+    assert t.result() is None
+
+
 def test_task_returncode(t):
     assert pygear.describe_returncode(t.returncode()) == 'INVALID_ARGUMENT'
 
@@ -70,3 +80,35 @@ def test_gc_traversal(t):
     sentinel = mock.Mock()
     t.set_serializer(sentinel)
     assert sentinel in gc.get_referents(t)
+
+
+def test_default_serializer_shared():
+    assert json in gc.get_referents(pygear.Task())
+
+
+def test_freelist_stats():
+    stats = pygear.freelist_stats()
+    assert set(stats) == set(['task', 'job'])
+    before = stats['task']['size']
+    t = pygear.Task(None, None)
+    del t
+    after = pygear.freelist_stats()['task']['size']
+    assert after == min(before + 1, stats['task']['max'])
+
+
+def test_set_wait_hook():
+    with pytest.raises(TypeError):
+        pygear.set_wait_hook(42)
+    pygear.set_wait_hook(lambda fd, timeout: None)
+    pygear.set_wait_hook(None)
+
+
+def test_poll():
+    c = pygear.Client()
+    w = pygear.Worker()
+    assert pygear.poll([c, w], timeout=0) == []
+    assert pygear.poll([], timeout=0) == []
+    with pytest.raises(TypeError):
+        pygear.poll([c, object()], timeout=0)
+    with pytest.raises(ValueError):
+        pygear.poll([c], timeout=-1)
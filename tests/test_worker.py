@@ -1,4 +1,6 @@
 import gc
+import threading
+import time
 
 import mock
 import pytest
@@ -101,10 +103,36 @@ def test_work_no_functions(w):
         w.work()
 
 
+def test_worker_fileno(w):
+    fd = w.fileno()
+    assert isinstance(fd, int)
+    assert w.fileno() == fd
+
+
+def test_worker_clone_fileno(w):
+    wc = w.clone()
+    del w
+    assert isinstance(wc.fileno(), int)
+
+
+def test_worker_step_no_functions(w):
+    w.add_server(TEST_SERVER_HOST, TEST_SERVER_PORT)
+    with pytest.raises(pygear.NO_REGISTERED_FUNCTIONS):
+        w.step()
+
+
 def test_set_serializer(w):
     w.set_serializer(noop_serializer())  # valid
     with pytest.raises(AttributeError):  # invalid
         w.set_serializer("a string doesn't implement loads.")
+    w.set_serializer(pygear.RAW)
+
+
+def test_worker_set_compression(w):
+    w.set_compression(1024, 1)
+    w.set_compression(None, function='reverse')
+    with pytest.raises(ValueError):
+        w.set_compression(1024, level=-2)
 
 
 def test_worker_set_timeout(w):
@@ -121,6 +149,44 @@ def test_work_timeout(w):
         w.work()
 
 
+def test_work_releases_gil(w):
+    ticks = []
+    done = threading.Event()
+
+    def background():
+        while not done.is_set():
+            ticks.append(1)
+            time.sleep(0.01)
+
+    w.add_function("test_method", 60, echo_function)
+    w.add_server(TEST_SERVER_HOST, TEST_SERVER_PORT)
+    w.set_timeout(500)
+    t = threading.Thread(target=background)
+    t.start()
+    try:
+        with pytest.raises(pygear.TIMEOUT):
+            w.work()
+    finally:
+        done.set()
+        t.join()
+    assert len(ticks) > 10
+
+
+def test_worker_serve_no_functions(w):
+    with pytest.raises(pygear.NO_REGISTERED_FUNCTIONS):
+        w.serve(processes=2)
+
+
+def test_worker_serve_needs_processes(w):
+    w.add_function("test_method", 60, echo_function)
+    with pytest.raises(ValueError):
+        w.serve(processes=0)
+
+
+def test_worker_serve_stats_before_serve(w):
+    assert w.serve_stats() == []
+
+
 def test_worker_unregister(w):
     assert not w.function_exists("test_method")
     w.register("test_method", 10)
@@ -0,0 +1,40 @@
+import pytest
+import pygear
+
+from . import TEST_SERVER_HOST
+from . import TEST_SERVER_PORT
+
+
+@pytest.fixture
+def w():
+    worker = pygear.Worker()
+    worker.add_server(TEST_SERVER_HOST, TEST_SERVER_PORT)
+    return worker
+
+
+def test_workerpool_size():
+    assert pygear.WorkerPool(4).size() == 4
+
+
+def test_workerpool_needs_threads():
+    with pytest.raises(ValueError):
+        pygear.WorkerPool(0)
+
+
+def test_workerpool_work_no_functions(w):
+    with pytest.raises(pygear.NO_REGISTERED_FUNCTIONS):
+        pygear.WorkerPool(2).work(w)
+
+
+def test_workerpool_stop_from_job(w):
+    pool = pygear.WorkerPool(2)
+
+    def stop_pool(job):
+        pool.stop()
+        return job.workload()
+
+    w.add_function("test_workerpool_stop", 0, stop_pool)
+    c = pygear.Client()
+    c.add_server(TEST_SERVER_HOST, TEST_SERVER_PORT)
+    c.do_background("test_workerpool_stop", "stop")
+    pool.work(w)  # returns once the job has stopped the pool
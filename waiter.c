@@ -0,0 +1,232 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "waiter.h"
+
+PyObject* _pygear_wait_hook = NULL;
+
+void _pygear_waiter_init(pygear_waiter_t* waiter, pygear_wait_fn wait, void* handle) {
+    waiter->wait = wait;
+    waiter->handle = handle;
+    waiter->fds[0] = waiter->fds[1] = -1;
+    waiter->started = 0;
+    waiter->armed = 0;
+    waiter->park = 0;
+    waiter->shutdown = 0;
+    waiter->timeout = -1;
+}
+
+/* private method */
+static long _pygear_waiter_elapsed_msec(const struct timeval* start) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) * 1000L + (now.tv_usec - start->tv_usec) / 1000L;
+}
+
+static void* _pygear_waiter_thread(void* arg) {
+    pygear_waiter_t* waiter = (pygear_waiter_t*) arg;
+    pthread_mutex_lock(&waiter->lock);
+    while (1) {
+        while (!waiter->armed && !waiter->shutdown) {
+            pthread_cond_wait(&waiter->cond, &waiter->lock);
+        }
+        if (waiter->shutdown) {
+            break;
+        }
+        // Short slices, so that the owner never waits long in park
+        int slice = PYGEAR_WAITER_SLICE_MSEC;
+        int expired = 0;
+        if (waiter->timeout >= 0) {
+            long remaining = waiter->timeout - _pygear_waiter_elapsed_msec(&waiter->armed_at);
+            expired = (remaining <= 0);
+            if (remaining < slice) {
+                slice = (int) remaining;
+            }
+        }
+        gearman_return_t result = GEARMAN_TIMEOUT;
+        if (!expired) {
+            pthread_mutex_unlock(&waiter->lock);
+            result = waiter->wait(waiter->handle, slice);
+            pthread_mutex_lock(&waiter->lock);
+        }
+        if (!waiter->park && !waiter->shutdown && result == GEARMAN_TIMEOUT && !expired) {
+            continue;
+        }
+        // Ready, failed or out of time; either way the owner has something to do
+        if (!waiter->park && !waiter->shutdown) {
+            while (write(waiter->fds[1], "!", 1) == -1 && errno == EINTR);
+        }
+        waiter->armed = 0;
+        pthread_cond_broadcast(&waiter->cond);
+    }
+    pthread_mutex_unlock(&waiter->lock);
+    return NULL;
+}
+
+int _pygear_waiter_fileno(pygear_waiter_t* waiter) {
+    if (waiter->started) {
+        return waiter->fds[0];
+    }
+    if (pipe(waiter->fds) == -1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+    int i;
+    for (i = 0; i < 2; ++i) {
+        fcntl(waiter->fds[i], F_SETFL, fcntl(waiter->fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(waiter->fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    pthread_mutex_init(&waiter->lock, NULL);
+    pthread_cond_init(&waiter->cond, NULL);
+    if (pthread_create(&waiter->thread, NULL, _pygear_waiter_thread, waiter) != 0) {
+        pthread_mutex_destroy(&waiter->lock);
+        pthread_cond_destroy(&waiter->cond);
+        close(waiter->fds[0]);
+        close(waiter->fds[1]);
+        waiter->fds[0] = waiter->fds[1] = -1;
+        PyErr_SetString(PyGearExn_ERROR, "Failed to start the waiter thread");
+        return -1;
+    }
+    waiter->started = 1;
+    return waiter->fds[0];
+}
+
+int _pygear_waiter_park(pygear_waiter_t* waiter) {
+    if (!waiter->started) {
+        waiter->armed = 0;
+        return 0;
+    }
+    // At most one slice, but do not hold up other python threads meanwhile
+    Py_BEGIN_ALLOW_THREADS
+    pthread_mutex_lock(&waiter->lock);
+    waiter->park = 1;
+    while (waiter->armed) {
+        pthread_cond_wait(&waiter->cond, &waiter->lock);
+    }
+    waiter->park = 0;
+    pthread_mutex_unlock(&waiter->lock);
+    Py_END_ALLOW_THREADS
+    int notified = 0;
+    char drain[64];
+    while (read(waiter->fds[0], drain, sizeof(drain)) > 0) {
+        notified = 1;
+    }
+    return notified;
+}
+
+void _pygear_waiter_arm(pygear_waiter_t* waiter, int timeout) {
+    // Without a thread yet, it starts out waiting once created
+    if (!waiter->started) {
+        waiter->armed = 1;
+        waiter->timeout = timeout;
+        gettimeofday(&waiter->armed_at, NULL);
+        return;
+    }
+    pthread_mutex_lock(&waiter->lock);
+    waiter->armed = 1;
+    waiter->timeout = timeout;
+    gettimeofday(&waiter->armed_at, NULL);
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+}
+
+int _pygear_waiter_cooperate(pygear_waiter_t* waiter, int timeout) {
+    int fd = _pygear_waiter_fileno(waiter);
+    if (fd == -1) {
+        return -1;
+    }
+    // The hook may yield to code that replaces it
+    PyObject* hook = _pygear_wait_hook;
+    Py_INCREF(hook);
+    _pygear_waiter_arm(waiter, timeout);
+    PyObject* hook_return;
+    if (timeout < 0) {
+        hook_return = PyObject_CallFunction(hook, "iO", fd, Py_None);
+    } else {
+        hook_return = PyObject_CallFunction(hook, "id", fd, timeout / 1000.0);
+    }
+    int ready = _pygear_waiter_park(waiter);
+    Py_DECREF(hook);
+    if (!hook_return) {
+        return -1;
+    }
+    Py_DECREF(hook_return);
+    return ready;
+}
+
+int _pygear_waiter_wait(pygear_waiter_t* waiter, int timeout) {
+    if (_pygear_wait_hook) {
+        return _pygear_waiter_cooperate(waiter, timeout);
+    }
+    struct timeval start;
+    gettimeofday(&start, NULL);
+    while (1) {
+        int slice = PYGEAR_WAITER_SIGNAL_MSEC;
+        if (timeout >= 0) {
+            long remaining = timeout - _pygear_waiter_elapsed_msec(&start);
+            if (remaining < slice) {
+                slice = (remaining > 0 ? (int) remaining : 0);
+            }
+        }
+        gearman_return_t result;
+        Py_BEGIN_ALLOW_THREADS
+        result = waiter->wait(waiter->handle, slice);
+        Py_END_ALLOW_THREADS
+        if (result != GEARMAN_TIMEOUT) {
+            return (_pygear_check_and_raise_exn(result) ? -1 : 1);
+        }
+        if (PyErr_CheckSignals()) {
+            return -1;
+        }
+        if (slice < PYGEAR_WAITER_SIGNAL_MSEC) {
+            return 0;
+        }
+    }
+}
+
+void _pygear_waiter_free(pygear_waiter_t* waiter) {
+    if (!waiter->started) {
+        return;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    pthread_mutex_lock(&waiter->lock);
+    waiter->shutdown = 1;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+    pthread_join(waiter->thread, NULL);
+    Py_END_ALLOW_THREADS
+    pthread_mutex_destroy(&waiter->lock);
+    pthread_cond_destroy(&waiter->cond);
+    close(waiter->fds[0]);
+    close(waiter->fds[1]);
+    waiter->fds[0] = waiter->fds[1] = -1;
+    waiter->started = 0;
+}
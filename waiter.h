@@ -0,0 +1,104 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include <libgearman-1.0/gearman.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include "exception.h"
+
+#ifndef PyMODINIT_FUNC
+#define PyMODINIT_FUNC void
+#endif
+
+#ifndef WAITER_H
+#define WAITER_H
+
+/* How long (in milliseconds) the waiter thread waits on libgearman at a
+ * time, so that its owner gets the connection back quickly */
+#define PYGEAR_WAITER_SLICE_MSEC 10
+
+/* How long (in milliseconds) blocking calls wait on libgearman between
+ * signal checks */
+#define PYGEAR_WAITER_SIGNAL_MSEC 100
+
+/* Waits up to timeout milliseconds for I/O on the connections of handle */
+typedef gearman_return_t (*pygear_wait_fn)(void* handle, int timeout);
+
+/*
+ * Readiness notification for event loops. libgearman keeps its sockets to
+ * itself, so a helper thread waits on them in its place and makes a pipe
+ * readable when the owner can make progress, or when the timeout given to
+ * _pygear_waiter_arm runs out. The thread only runs between
+ * _pygear_waiter_arm and _pygear_waiter_park, while the owner leaves the
+ * libgearman structure alone.
+ */
+typedef struct {
+    pygear_wait_fn wait;
+    void* handle;
+    int fds[2];         /* notification pipe, fds[0] is handed out */
+    int started;
+    int armed;          /* the thread is (or is about to be) waiting */
+    int park;           /* the owner wants the thread to stop waiting */
+    int shutdown;
+    int timeout;        /* of the current arm in milliseconds, none if negative */
+    struct timeval armed_at;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} pygear_waiter_t;
+
+/* Set by pygear.set_wait_hook; NULL unless blocking calls should cooperate */
+extern PyObject* _pygear_wait_hook;
+
+void _pygear_waiter_init(pygear_waiter_t* waiter, pygear_wait_fn wait, void* handle);
+/* Stop and join the thread and close the pipe; call with the GIL held */
+void _pygear_waiter_free(pygear_waiter_t* waiter);
+/* Readable end of the pipe, starting the thread on first use. Returns -1
+ * with an exception set on failure. */
+int _pygear_waiter_fileno(pygear_waiter_t* waiter);
+/* Take the connection back from the thread and clear the pipe. Call with
+ * the GIL held before touching the libgearman structure. Returns 1 if the
+ * pipe had been made readable, 0 otherwise. */
+int _pygear_waiter_park(pygear_waiter_t* waiter);
+/* Hand the connection to the thread, if fileno() was ever requested, for at
+ * most timeout milliseconds (no limit if negative) */
+void _pygear_waiter_arm(pygear_waiter_t* waiter, int timeout);
+/* Block in _pygear_wait_hook until the connection has I/O, for at most
+ * timeout milliseconds (no limit if negative). Returns 1 on I/O, 0 if the
+ * hook returned without any, or -1 with an exception set. */
+int _pygear_waiter_cooperate(pygear_waiter_t* waiter, int timeout);
+/* Wait for I/O on behalf of a blocking call, for at most timeout
+ * milliseconds (no limit if negative). Goes through the wait hook if set,
+ * otherwise waits without the GIL in short slices and runs signal handlers
+ * in between. The thread must be parked. Returns like
+ * _pygear_waiter_cooperate. */
+int _pygear_waiter_wait(pygear_waiter_t* waiter, int timeout);
+
+#endif
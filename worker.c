@@ -26,31 +26,55 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include "worker.h"
 
+/* Upper bound (in milliseconds) on how long a 'serve' child blocks in
+ * libgearman before it checks for signals and its parent */
+#define PYGEAR_SERVE_POLL_MSEC 1000
+
+/* How long (in microseconds) the 'serve' parent sleeps between checks on
+ * its children */
+#define PYGEAR_SERVE_REAP_USEC 100000
+
 /*
  * Class constructor / destructor methods
  */
 
+/* private method, the pygear_wait_fn of the worker's waiter */
+static gearman_return_t _pygear_worker_wait(void* handle, int timeout) {
+    gearman_worker_st* g_worker = (gearman_worker_st*) handle;
+    int worker_timeout = gearman_worker_timeout(g_worker);
+    gearman_worker_set_timeout(g_worker, timeout);
+    gearman_return_t result = gearman_worker_wait(g_worker);
+    gearman_worker_set_timeout(g_worker, worker_timeout);
+    return result;
+}
+
 /* Return -1 if fail, 0 if success */
 int Worker_init(pygear_WorkerObject* self, PyObject* args, PyObject* kwds) {
     self->g_Worker = gearman_worker_create(NULL);
+    _pygear_waiter_init(&self->waiter, _pygear_worker_wait, self->g_Worker);
     gearman_worker_options_t worker_options = gearman_worker_options(self->g_Worker);
     worker_options = worker_options & (~GEARMAN_WORKER_GRAB_ALL);
     gearman_worker_set_options(self->g_Worker, worker_options);
     self->g_FunctionMap = PyDict_New();
-    self->serializer = PyImport_ImportModule(PYTHON_SERIALIZER);
+    self->g_SchemaMap = PyDict_New();
+    self->compression = _pygear_compression_off;
+    self->compression_map = PyDict_New();
+    self->serializer = _pygear_default_serializer();
+    self->codec = NULL;
+    self->typed_arrays = 0;
     if (self->serializer == NULL) {
-        PyObject* err_string = PyString_FromFormat("Failed to import '%s'", PYTHON_SERIALIZER);
-        PyErr_SetObject(PyExc_ImportError, err_string);
-        Py_XDECREF(err_string);
         return -1;
     }
     if (self->g_Worker == NULL) {
         PyErr_SetString(PyGearExn_ERROR, "Failed to create internal gearman worker structure.");
         return -1;
     }
-    if (self->g_FunctionMap == NULL) {
+    if (self->g_FunctionMap == NULL || self->g_SchemaMap == NULL || self->compression_map == NULL) {
         PyErr_SetString(PyGearExn_ERROR, "Failed to create internal dictionary for functions.");
         return -1;
     }
@@ -60,6 +84,8 @@ int Worker_init(pygear_WorkerObject* self, PyObject* args, PyObject* kwds) {
 
 int Worker_traverse(pygear_WorkerObject *self,  visitproc visit, void *arg) {
     Py_VISIT(self->g_FunctionMap);
+    Py_VISIT(self->g_SchemaMap);
+    Py_VISIT(self->compression_map);
     Py_VISIT(self->serializer);
     Py_VISIT(self->cb_log);
     return 0;
@@ -67,16 +93,23 @@ int Worker_traverse(pygear_WorkerObject *self,  visitproc visit, void *arg) {
 
 int Worker_clear(pygear_WorkerObject* self) {
     Py_CLEAR(self->g_FunctionMap);
+    Py_CLEAR(self->g_SchemaMap);
+    Py_CLEAR(self->compression_map);
     Py_CLEAR(self->serializer);
     Py_CLEAR(self->cb_log);
     return 0;
 }
 
 void Worker_dealloc(pygear_WorkerObject* self) {
+    _pygear_waiter_free(&self->waiter);
     if (self->g_Worker) {
         gearman_worker_free(self->g_Worker);
         self->g_Worker = NULL;
     }
+    if (self->serve_slots) {
+        munmap(self->serve_slots, sizeof(pygear_serve_slot) * self->serve_processes);
+        self->serve_slots = NULL;
+    }
     Worker_clear(self);
     self->ob_type->tp_free((PyObject*)self);
 }
@@ -85,16 +118,28 @@ void Worker_dealloc(pygear_WorkerObject* self) {
  * Instance Methods
  */
 
-static PyObject* pygear_worker_add_function(pygear_WorkerObject* self, PyObject* args) {
+static PyObject* pygear_worker_add_function(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs) {
     char* function_name;
     int timeout; // in seconds
     PyObject* function;
-    if (!PyArg_ParseTuple(args, "siO", &function_name, &timeout, &function)) {
+    PyObject* schema = Py_None;
+    static char* kwlist[] = {"function_name", "timeout", "function", "schema", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "siO|O", kwlist,
+        &function_name, &timeout, &function, &schema)) {
+        return NULL;
+    }
+    if (schema != Py_None && !PyObject_TypeCheck(schema, &pygear_SchemaType)) {
+        PyErr_SetString(PyExc_TypeError, "schema must be a pygear.Schema or None");
         return NULL;
     }
     Py_INCREF(function);
     PyObject* function_name_str = PyString_FromString(function_name);
     PyDict_SetItem(self->g_FunctionMap, function_name_str, function);
+    if (schema != Py_None) {
+        PyDict_SetItem(self->g_SchemaMap, function_name_str, schema);
+    } else if (PyDict_DelItem(self->g_SchemaMap, function_name_str) == -1) {
+        PyErr_Clear();  // no schema registered before
+    }
     Py_DECREF(function_name_str);
     Py_DECREF(function);
     gearman_return_t result = gearman_worker_add_function(
@@ -168,8 +213,19 @@ static PyObject* pygear_worker_clone(pygear_WorkerObject* self) {
     PyObject* ret = NULL;
     argList = Py_BuildValue("(O, O)", Py_None, Py_None);
     python_worker = (pygear_WorkerObject*) PyObject_CallObject((PyObject *) &pygear_WorkerType, argList);
+    if (!python_worker) {
+        goto catch;
+    }
+    gearman_worker_free(python_worker->g_Worker);
     python_worker->g_Worker = gearman_worker_clone(NULL, self->g_Worker);
+    if (!python_worker->g_Worker) {
+        PyErr_SetString(PyGearExn_ERROR, "Failed to clone internal gearman worker structure.");
+        goto catch;
+    }
+    // The waiter was set up for the structure just freed
+    _pygear_waiter_init(&python_worker->waiter, _pygear_worker_wait, python_worker->g_Worker);
     ret = Py_BuildValue("O", python_worker); // build new reference to return
+catch:
     Py_XDECREF(argList);
     Py_XDECREF(python_worker);
     return ret;
@@ -182,11 +238,14 @@ static PyObject* pygear_worker_echo(pygear_WorkerObject* self, PyObject* args) {
     if (!PyArg_ParseTuple(args, "s#", &workload, &workload_size)) {
         return NULL;
     }
-    gearman_return_t result = gearman_worker_echo(
+    gearman_return_t result;
+    Py_BEGIN_ALLOW_THREADS
+    result = gearman_worker_echo(
         self->g_Worker,
         workload,
         workload_size
     );
+    Py_END_ALLOW_THREADS
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
@@ -269,36 +328,23 @@ static PyObject* pygear_worker_get_options(pygear_WorkerObject* self) {
 
 static PyObject* pygear_worker_grab_job(pygear_WorkerObject* self) {
     gearman_return_t result;
-    gearman_job_st* new_job = gearman_worker_grab_job(self->g_Worker, NULL, &result);
-    PyObject* argList = NULL;
-    pygear_JobObject* python_job = NULL;
-    PyObject* callmethod_result = NULL;
-    PyObject* ret = NULL;
+    gearman_job_st* new_job;
+    Py_BEGIN_ALLOW_THREADS
+    new_job = gearman_worker_grab_job(self->g_Worker, NULL, &result);
+    Py_END_ALLOW_THREADS
     if (_pygear_check_and_raise_exn(result)) {
-        goto catch;
-    }
-    argList = Py_BuildValue("(O, O)", Py_None, Py_None);
-    if (!argList) {
-        PyErr_SetString(PyExc_RuntimeError, "Failed to instantiate argument tuple for new Job object");
-        goto catch;
-    }
-    python_job = (pygear_JobObject*) PyObject_CallObject((PyObject *) &pygear_JobType, argList);
-    if (!python_job) {
-        PyErr_SetString(PyExc_RuntimeError, "Failed to instantiate new Job object");
-        goto catch;
+        return NULL;
     }
-    callmethod_result = PyObject_CallMethod((PyObject*) python_job, "set_serializer", "O", self->serializer);
-    if (!callmethod_result) {
-        goto catch;
+    pygear_JobObject* job = _pygear_job_new(self->serializer, self->codec, self->typed_arrays, new_job);
+    if (job) {
+        // borrowed
+        PyObject* schema = PyDict_GetItemString(self->g_SchemaMap, gearman_job_function_name(new_job));
+        Py_XINCREF(schema);
+        job->schema = schema;
+        _pygear_compression_for(self->compression_map, &self->compression,
+            gearman_job_function_name(new_job), &job->compression);
     }
-    python_job->g_Job = new_job;
-    ret = Py_BuildValue("O", python_job);
-
-catch:
-    Py_XDECREF(argList);
-    Py_XDECREF(python_job);
-    Py_XDECREF(callmethod_result);
-    return ret;
+    return (PyObject*) job;
 }
 
 
@@ -446,26 +492,26 @@ static PyObject* pygear_worker_set_options(pygear_WorkerObject* self, PyObject*
 }
 
 
-static PyObject* pygear_worker_set_serializer(pygear_WorkerObject* self, PyObject* args) {
+static PyObject* pygear_worker_set_serializer(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs) {
     PyObject* serializer = NULL;
-    if (!PyArg_ParseTuple(args, "O", &serializer)) {
-        return NULL;
-    }
-    if (!PyObject_HasAttrString(serializer, "loads")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'loads'");
-        return NULL;
-    }
-    if (!PyObject_HasAttrString(serializer, "dumps")) {
-        PyErr_SetString(PyExc_AttributeError, "Serializer does not implement 'dumps'");
+    int typed_arrays;
+    if (_pygear_parse_serializer(args, kwargs, &serializer, &typed_arrays) == -1) {
         return NULL;
     }
     Py_INCREF(serializer);
     Py_XDECREF(self->serializer);  // dealloc the old one
     self->serializer = serializer;
+    self->codec = _pygear_lookup_codec(serializer);
+    self->typed_arrays = typed_arrays;
     Py_RETURN_NONE;
 }
 
 
+static PyObject* pygear_worker_set_compression(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs) {
+    return _pygear_set_compression(args, kwargs, &self->compression, self->compression_map);
+}
+
+
 static PyObject* pygear_worker_set_timeout(pygear_WorkerObject* self, PyObject* args) {
     int timeout;
     if (!PyArg_ParseTuple(args, "i", &timeout)) {
@@ -482,7 +528,10 @@ static PyObject* pygear_worker_timeout(pygear_WorkerObject* self) {
 
 
 static PyObject* pygear_worker_wait(pygear_WorkerObject* self) {
-    gearman_return_t result = gearman_worker_wait(self->g_Worker);
+    gearman_return_t result;
+    Py_BEGIN_ALLOW_THREADS
+    result = gearman_worker_wait(self->g_Worker);
+    Py_END_ALLOW_THREADS
     if (_pygear_check_and_raise_exn(result)) {
         return NULL;
     }
@@ -501,20 +550,20 @@ void* _pygear_worker_function_mapper(gearman_job_st* gear_job, void* context,
     const char* job_func_name = gearman_job_function_name(gear_job);
     PyObject* job_func_name_str = PyString_FromString(job_func_name);
     PyObject* python_cb_method = PyDict_GetItem(worker->g_FunctionMap, job_func_name_str);
+    PyObject* schema = PyDict_GetItem(worker->g_SchemaMap, job_func_name_str);
     Py_XDECREF(job_func_name_str);
 
     // new refs
-    PyObject* argList = NULL;
     pygear_JobObject* python_job = NULL;
-    PyObject* callmethod_result = NULL;
     PyObject* callback_return = NULL;
-    PyObject* pickled_result = NULL;
     PyObject* ptype_repr = NULL;
     PyObject* pvalue_args = NULL;
     PyObject* traceback = NULL;
     PyObject* string_traceback = NULL;
     PyObject* error_tuple = NULL;
     PyObject* serialized_data = NULL;
+    Py_buffer payload;
+    int has_payload = 0;
 
     enum {FAIL, SUCCESS, UNDEFINED};
     int retptr = FAIL;
@@ -525,14 +574,15 @@ void* _pygear_worker_function_mapper(gearman_job_st* gear_job, void* context,
     }
 
     // Bind the job into a python representation, and call through the python callback method
-    argList = Py_BuildValue("(O, O)", Py_None, Py_None);
-    python_job = (pygear_JobObject*) PyObject_CallObject((PyObject *) &pygear_JobType, argList);
-    callmethod_result = PyObject_CallMethod((PyObject*) python_job, "set_serializer", "O", worker->serializer);
-    if (!callmethod_result) {
+    python_job = _pygear_job_new(worker->serializer, worker->codec, worker->typed_arrays, gear_job);
+    if (!python_job) {
         goto catch;
     }
-
-    python_job->g_Job = gear_job;
+    if (schema) {
+        Py_INCREF(schema);
+        python_job->schema = schema;
+    }
+    _pygear_compression_for(worker->compression_map, &worker->compression, job_func_name, &python_job->compression);
 
     callback_return = PyObject_CallFunction(python_cb_method, "O", python_job);
 
@@ -598,20 +648,26 @@ void* _pygear_worker_function_mapper(gearman_job_st* gear_job, void* context,
             }
             goto catch;
         }
-        serialized_data = PyObject_CallMethod(worker->serializer, "dumps", "(O)", error_tuple);
-        if (!serialized_data) {
+        if (PYGEAR_IS_RAW(worker->serializer)) {
+            // No serializer to carry the tuple, so send its repr as text
+            serialized_data = PyObject_Repr(error_tuple);
+        } else {
+            serialized_data = error_tuple;
+            Py_INCREF(serialized_data);
+        }
+        if (!serialized_data
+            || _pygear_serialize(worker->serializer, worker->codec, worker->typed_arrays, serialized_data, &payload) == -1) {
             if (!PyErr_Occurred()) {
                 PyErr_SetString(PyExc_SystemError, "Failed to serialize exception data\n");
             }
             goto catch;
         }
-        char* c_data; Py_ssize_t c_data_size;
-        if (PyString_AsStringAndSize(serialized_data, &c_data, &c_data_size) == -1) {
-            PyErr_SetString(PyExc_SystemError, "Failed to stringify serialized exception data\n");
+        has_payload = 1;
+        if (_pygear_compress(worker->serializer, &python_job->compression, &payload) == -1) {
             goto catch;
         }
 
-        gearman_return_t exn_sent = gearman_job_send_exception(gear_job, c_data, c_data_size);
+        gearman_return_t exn_sent = gearman_job_send_exception(gear_job, payload.buf, payload.len);
 
         if (!gearman_success(exn_sent)) {
             PyObject* err_string = PyString_FromFormat("Failed to send exception data for job: %s\n", gearman_strerror(exn_sent));
@@ -624,25 +680,18 @@ void* _pygear_worker_function_mapper(gearman_job_st* gear_job, void* context,
 
     } else {
         // Try to pickle the return from the function
-        PyObject* dumpstr = PyString_FromString("dumps");
-        pickled_result = PyObject_CallMethodObjArgs (
-            worker->serializer,
-            dumpstr,
-            callback_return,
-            NULL
-        );
-        Py_XDECREF(dumpstr);
-        if (!pickled_result) {
+        if (_pygear_serialize(worker->serializer, worker->codec, worker->typed_arrays, callback_return, &payload) == -1) {
             if (!PyErr_Occurred()) {
                 PyErr_SetString(PyExc_SystemError, "Failed to serialize worker result data\n");
             }
             goto catch;
         }
         else {
-            Py_ssize_t len;
-            char* buffer;
-            PyString_AsStringAndSize(pickled_result, &buffer, &len);
-            if (_pygear_check_and_raise_exn(gearman_job_send_complete(gear_job, buffer, len))) {
+            has_payload = 1;
+            if (_pygear_compress(worker->serializer, &python_job->compression, &payload) == -1) {
+                goto catch;
+            }
+            if (_pygear_check_and_raise_exn(gearman_job_send_complete(gear_job, payload.buf, payload.len))) {
                 PyErr_Print();
                 retptr = UNDEFINED;
             } else {
@@ -652,16 +701,18 @@ void* _pygear_worker_function_mapper(gearman_job_st* gear_job, void* context,
     }
 
 catch:
-    Py_XDECREF(pickled_result);
-    Py_XDECREF(callmethod_result);
-    Py_XDECREF(argList);
+    if (has_payload) {
+        PyBuffer_Release(&payload);
+    }
     Py_XDECREF(ptype_repr);
     Py_XDECREF(pvalue_args);
     Py_XDECREF(traceback);
     Py_XDECREF(string_traceback);
     Py_XDECREF(error_tuple);
     Py_XDECREF(serialized_data);
-    python_job->g_Job = NULL;
+    if (python_job) {
+        _pygear_job_detach(python_job);
+    }
     Py_XDECREF(python_job);
     Py_XDECREF(callback_return);
 
@@ -678,8 +729,43 @@ catch:
 }
 
 
+/* private method; gearman_worker_work, waiting through _pygear_waiter_wait so
+ * that signals and the wait hook get a turn */
+static gearman_return_t _pygear_worker_work_interruptible(pygear_WorkerObject* self) {
+    int was_non_blocking = gearman_worker_options(self->g_Worker) & GEARMAN_WORKER_NON_BLOCKING;
+    gearman_worker_add_options(self->g_Worker, GEARMAN_WORKER_NON_BLOCKING);
+    int timeout = gearman_worker_timeout(self->g_Worker);
+    gearman_return_t result;
+    while (1) {
+        Py_BEGIN_ALLOW_THREADS
+        result = gearman_worker_work(self->g_Worker);
+        Py_END_ALLOW_THREADS
+        if (PyErr_Occurred() || (result != GEARMAN_IO_WAIT && result != GEARMAN_NO_JOBS)) {
+            break;
+        }
+        int ready = _pygear_waiter_wait(&self->waiter, timeout);
+        if (ready == -1) {
+            break;
+        }
+        if (!ready && timeout >= 0) {
+            result = GEARMAN_TIMEOUT;
+            break;
+        }
+    }
+    if (!was_non_blocking) {
+        gearman_worker_remove_options(self->g_Worker, GEARMAN_WORKER_NON_BLOCKING);
+    }
+    return result;
+}
+
 static PyObject* pygear_worker_work(pygear_WorkerObject* self) {
-    gearman_return_t result = gearman_worker_work(self->g_Worker);
+    /*
+     * Only hold the GIL while a job is being dispatched; the function mapper
+     * takes it back with PyGILState_Ensure. Any error it leaves behind stays
+     * attached to this thread's state and is picked up below.
+     */
+    _pygear_waiter_park(&self->waiter);
+    gearman_return_t result = _pygear_worker_work_interruptible(self);
     if (PyErr_Occurred()) {
         return NULL;
     }
@@ -689,6 +775,279 @@ static PyObject* pygear_worker_work(pygear_WorkerObject* self) {
     Py_RETURN_NONE;
 }
 
+static PyObject* pygear_worker_step(pygear_WorkerObject* self) {
+    _pygear_waiter_park(&self->waiter);
+    // Keep working until libgearman would block, since nothing asks the job
+    // server for the next job until then
+    int was_non_blocking = gearman_worker_options(self->g_Worker) & GEARMAN_WORKER_NON_BLOCKING;
+    gearman_worker_add_options(self->g_Worker, GEARMAN_WORKER_NON_BLOCKING);
+    long jobs = -1;
+    gearman_return_t result;
+    do {
+        ++jobs;
+        Py_BEGIN_ALLOW_THREADS
+        result = gearman_worker_work(self->g_Worker);
+        Py_END_ALLOW_THREADS
+    } while (result == GEARMAN_SUCCESS && !PyErr_Occurred());
+    if (!was_non_blocking) {
+        gearman_worker_remove_options(self->g_Worker, GEARMAN_WORKER_NON_BLOCKING);
+    }
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+    if (result != GEARMAN_IO_WAIT && result != GEARMAN_NO_JOBS && _pygear_check_and_raise_exn(result)) {
+        return NULL;
+    }
+    _pygear_waiter_arm(&self->waiter, gearman_worker_timeout(self->g_Worker));
+    return PyInt_FromLong(jobs);
+}
+
+static PyObject* pygear_worker_fileno(pygear_WorkerObject* self) {
+    int fd = _pygear_waiter_fileno(&self->waiter);
+    if (fd == -1) {
+        return NULL;
+    }
+    return PyInt_FromLong(fd);
+}
+
+
+/*
+ * Create a new connection to the same servers with the same options and
+ * functions as the worker. gearman_worker_clone copies registrations on
+ * current libgearman releases; anything it missed is registered again here
+ * without a job timeout.
+ */
+gearman_worker_st* _pygear_worker_clone_connection(pygear_WorkerObject* self) {
+    gearman_worker_st* clone = gearman_worker_clone(NULL, self->g_Worker);
+    if (clone == NULL) {
+        return NULL;
+    }
+    PyObject* function_name;
+    PyObject* function;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(self->g_FunctionMap, &pos, &function_name, &function)) {
+        char* name = PyString_AsString(function_name);
+        if (name && !gearman_worker_function_exist(clone, name, strlen(name))) {
+            gearman_worker_add_function(clone, name, 0, _pygear_worker_function_mapper, self);
+        }
+    }
+    return clone;
+}
+
+
+static volatile sig_atomic_t _pygear_serve_child_stopping = 0;
+
+static void _pygear_serve_child_sigterm(int signum) {
+    _pygear_serve_child_stopping = 1;
+}
+
+static void _pygear_flush_std_streams(void) {
+    PyObject* stream = PySys_GetObject("stdout");  // borrowed
+    PyObject* result = stream ? PyObject_CallMethod(stream, "flush", NULL) : NULL;
+    Py_XDECREF(result);
+    stream = PySys_GetObject("stderr");
+    result = stream ? PyObject_CallMethod(stream, "flush", NULL) : NULL;
+    Py_XDECREF(result);
+    PyErr_Clear();
+}
+
+/*
+ * Body of a 'serve' child. Runs its own work loop on a fresh connection
+ * until it has done max_jobs jobs, is asked to stop, or loses its parent.
+ * Never returns.
+ */
+static void _pygear_serve_child(pygear_WorkerObject* self, pygear_serve_slot* slot,
+    pid_t parent, unsigned long max_jobs) {
+
+    int exit_code = 0;
+    PyOS_AfterFork();
+    signal(SIGTERM, _pygear_serve_child_sigterm);
+
+    gearman_worker_st* g_Worker = _pygear_worker_clone_connection(self);
+    if (g_Worker == NULL) {
+        _exit(1);
+    }
+    int timeout = gearman_worker_timeout(g_Worker);
+    if (timeout < 0 || timeout > PYGEAR_SERVE_POLL_MSEC) {
+        gearman_worker_set_timeout(g_Worker, PYGEAR_SERVE_POLL_MSEC);
+    }
+
+    while (!_pygear_serve_child_stopping && getppid() == parent) {
+        gearman_return_t result;
+        Py_BEGIN_ALLOW_THREADS
+        result = gearman_worker_work(g_Worker);
+        Py_END_ALLOW_THREADS
+        if (PyErr_Occurred()) {
+            // Job function errors have already been printed and sent back to
+            // the client by the function mapper; only exit requests stop us
+            if (PyErr_ExceptionMatches(PyExc_KeyboardInterrupt) ||
+                PyErr_ExceptionMatches(PyExc_SystemExit)) {
+                PyErr_Clear();
+                break;
+            }
+            PyErr_Clear();
+        }
+        if (result == GEARMAN_SUCCESS) {
+            slot->jobs++;
+            if (max_jobs && slot->jobs >= max_jobs) {
+                break;
+            }
+        } else if (result != GEARMAN_TIMEOUT && result != GEARMAN_IO_WAIT &&
+                   result != GEARMAN_NO_JOBS) {
+            // Let the parent start a replacement after a short pause, so an
+            // unreachable server does not turn into a fork loop
+            _pygear_check_and_raise_exn(result);
+            PyErr_Print();
+            exit_code = 1;
+            Py_BEGIN_ALLOW_THREADS
+            sleep(1);
+            Py_END_ALLOW_THREADS
+            break;
+        }
+        if (PyErr_CheckSignals()) {
+            PyErr_Clear();
+            break;
+        }
+    }
+    gearman_worker_free(g_Worker);
+    _pygear_flush_std_streams();
+    _exit(exit_code);
+}
+
+/* Fork a child into the given slot. Returns 0 on success, -1 on failure. */
+static int _pygear_serve_spawn(pygear_WorkerObject* self, pygear_serve_slot* slot,
+    unsigned long max_jobs) {
+
+    pid_t parent = getpid();
+    _pygear_flush_std_streams();
+    pid_t pid = fork();
+    if (pid < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+    if (pid == 0) {
+        slot->pid = getpid();
+        slot->jobs = 0;
+        _pygear_serve_child(self, slot, parent, max_jobs);
+    }
+    slot->pid = pid;
+    return 0;
+}
+
+/* Ask every child to stop and wait for all of them. */
+static void _pygear_serve_shutdown(pygear_WorkerObject* self) {
+    int i;
+    for (i = 0; i < self->serve_processes; ++i) {
+        if (self->serve_slots[i].pid > 0) {
+            kill(self->serve_slots[i].pid, SIGTERM);
+        }
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < self->serve_processes; ++i) {
+        pygear_serve_slot* slot = &self->serve_slots[i];
+        if (slot->pid > 0) {
+            while (waitpid(slot->pid, NULL, 0) < 0 && errno == EINTR);
+            slot->total_jobs += slot->jobs;
+            slot->jobs = 0;
+            slot->pid = 0;
+        }
+    }
+    Py_END_ALLOW_THREADS
+}
+
+
+static PyObject* pygear_worker_serve(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs) {
+    int processes = 1;
+    unsigned long max_jobs = 0;
+    static char* kwlist[] = {"processes", "max_jobs_per_child", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|ik", kwlist, &processes, &max_jobs)) {
+        return NULL;
+    }
+    if (processes < 1) {
+        PyErr_SetString(PyExc_ValueError, "serve needs at least one process");
+        return NULL;
+    }
+    if (PyDict_Size(self->g_FunctionMap) == 0) {
+        _pygear_check_and_raise_exn(GEARMAN_NO_REGISTERED_FUNCTIONS);
+        return NULL;
+    }
+
+    // Counters live in anonymous shared memory so children can update them
+    if (self->serve_slots) {
+        munmap(self->serve_slots, sizeof(pygear_serve_slot) * self->serve_processes);
+        self->serve_slots = NULL;
+    }
+    void* slots = mmap(NULL, sizeof(pygear_serve_slot) * processes,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (slots == MAP_FAILED) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return NULL;
+    }
+    memset(slots, 0, sizeof(pygear_serve_slot) * processes);
+    self->serve_slots = (pygear_serve_slot*) slots;
+    self->serve_processes = processes;
+
+    int i;
+    for (i = 0; i < processes; ++i) {
+        if (_pygear_serve_spawn(self, &self->serve_slots[i], max_jobs) < 0) {
+            goto catch;
+        }
+    }
+
+    while (1) {
+        Py_BEGIN_ALLOW_THREADS
+        usleep(PYGEAR_SERVE_REAP_USEC);
+        Py_END_ALLOW_THREADS
+        if (PyErr_CheckSignals()) {
+            goto catch;
+        }
+        for (i = 0; i < processes; ++i) {
+            pygear_serve_slot* slot = &self->serve_slots[i];
+            if (waitpid(slot->pid, NULL, WNOHANG) != slot->pid) {
+                continue;
+            }
+            slot->total_jobs += slot->jobs;
+            slot->jobs = 0;
+            slot->pid = 0;
+            slot->restarts++;
+            if (_pygear_serve_spawn(self, slot, max_jobs) < 0) {
+                goto catch;
+            }
+        }
+    }
+
+catch:
+    _pygear_serve_shutdown(self);
+    return NULL;
+}
+
+
+static PyObject* pygear_worker_serve_stats(pygear_WorkerObject* self) {
+    PyObject* stats = PyList_New(0);
+    if (!stats) {
+        return NULL;
+    }
+    int i;
+    for (i = 0; self->serve_slots && i < self->serve_processes; ++i) {
+        pygear_serve_slot* slot = &self->serve_slots[i];
+        unsigned long jobs = slot->jobs;
+        PyObject* slot_dict = Py_BuildValue(
+            "{s:i, s:k, s:k, s:k}",
+            "pid", (int) slot->pid,
+            "jobs", jobs,
+            "total_jobs", slot->total_jobs + jobs,
+            "restarts", slot->restarts
+        );
+        if (!slot_dict || PyList_Append(stats, slot_dict) < 0) {
+            Py_XDECREF(slot_dict);
+            Py_DECREF(stats);
+            return NULL;
+        }
+        Py_DECREF(slot_dict);
+    }
+    return stats;
+}
+
 
 static PyObject* pygear_worker_unregister(pygear_WorkerObject* self, PyObject* args) {
     char* function_name;
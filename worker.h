@@ -30,6 +30,9 @@
 #include <libgearman-1.0/gearman.h>
 #include <stdio.h>
 #include "structmember.h"
+#include "serializer.h"
+#include "schema.h"
+#include "waiter.h"
 
 #ifndef PyMODINIT_FUNC
 #define PyMODINIT_FUNC void
@@ -40,12 +43,28 @@
 
 #define _WORKERMETHOD(name,flags) {#name,(PyCFunction) pygear_worker_##name,flags,pygear_worker_##name##_doc},
 
+/* Per-child bookkeeping for 'serve', kept in memory shared with the children */
+typedef struct {
+    pid_t pid;
+    volatile unsigned long jobs;    /* written by the running child */
+    unsigned long total_jobs;       /* jobs done by earlier children in this slot */
+    unsigned long restarts;
+} pygear_serve_slot;
+
 typedef struct {
     PyObject_HEAD
     struct gearman_worker_st* g_Worker;
     PyObject* g_FunctionMap;
+    PyObject* g_SchemaMap;      /* function name -> pygear.Schema for its workloads */
+    pygear_compression_t compression;
+    PyObject* compression_map;  /* function name -> (threshold, level) */
     PyObject* serializer;
+    pygear_codec_t* codec;      /* native codec of serializer, borrowed */
+    int typed_arrays;           /* set_serializer(typed_arrays=...) */
     PyObject* cb_log;
+    pygear_serve_slot* serve_slots;
+    int serve_processes;
+    pygear_waiter_t waiter;     /* backs fileno() */
 } pygear_WorkerObject;
 
 PyDoc_STRVAR(worker_module_docstring, "Represents a Gearman worker.");
@@ -59,16 +78,20 @@ void Worker_dealloc(pygear_WorkerObject* self);
 /* Private methods */
 void* _pygear_worker_function_mapper(gearman_job_st* gear_job, void* context,
     size_t* result_size, gearman_return_t* ret_ptr);
+gearman_worker_st* _pygear_worker_clone_connection(pygear_WorkerObject* self);
 
 /* Method definitions */
-static PyObject* pygear_worker_add_function(pygear_WorkerObject* self, PyObject* args);
+static PyObject* pygear_worker_add_function(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_worker_add_function_doc,
 "Register and add callback function for worker. To remove functions that have\n"
 "been added, call 'unregister' or 'unregister_all'.\n\n"
 "@param[in] function_name - Function name to register.\n"
 "@param[in] timeout - Timeout (in seconds) that specifies the maximum time a\n"
 "\tjob should execute. A value of 0 means infinite time.\n"
-"@param[in] function - Function (that takes a Job instance) to run.\n\n"
+"@param[in] function - Function (that takes a Job instance) to run.\n"
+"@param[in] schema - Optional pygear.Schema that job workloads for this\n"
+"\tfunction are decoded with instead of the serializer. Clients must send\n"
+"\tthem with the same schema. Results still use the serializer.\n\n"
 "@return None on success.\n"
 "@return NULL and raises pygear exception on failure.\n\n"
 "Example:\n"
@@ -210,15 +233,58 @@ PyDoc_STRVAR(pygear_worker_set_options_doc,
 "Set options for a worker.\n\n"
 "@param[in] options - Dictionary of options to set on the worker.");
 
-static PyObject* pygear_worker_set_serializer(pygear_WorkerObject* self, PyObject* args);
+static PyObject* pygear_worker_set_serializer(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs);
 PyDoc_STRVAR(pygear_worker_set_serializer_doc,
 "Specify the object to be used to serialize data passed through gearman.\n"
 "By default, pygear will use 'json' to convert data to a string\n"
 "representation during transit and reconstitute it on the other end.\n"
 "You can replace the serializer with your own as long as it implements\n"
 "the 'dumps' and 'loads' methods. 'dumps' must return a string, and loads\n"
-"must take a string.\n\n"
-"@param[in] serializer - Object implementing dumps and loads.");
+"must take a string. Pass None (pygear.RAW) to skip serialization and\n"
+"send and receive plain strings.\n\n"
+"@param[in] serializer - Object implementing dumps and loads, or None.\n"
+"@param[in] typed_arrays - If True, exchange numeric arrays as raw\n"
+"\telements; see Client.set_serializer.");
+
+static PyObject* pygear_worker_set_compression(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_worker_set_compression_doc,
+"Compress job results (and data, warnings and exceptions sent by jobs)\n"
+"with zlib once they are at least 'threshold' bytes after serialization.\n"
+"Clients decompress them on their own, whatever their own settings.\n"
+"Compression is off by default and never applies in RAW mode.\n\n"
+"@param[in] threshold - Smallest payload size to compress, or None to turn\n"
+"\tcompression off.\n"
+"@param[in] level - Optional zlib level, 0-9, or -1 for zlib's default.\n"
+"@param[in] function - Optional function name. The settings then only\n"
+"\tapply to jobs of that function and override the worker-wide ones.");
+
+static PyObject* pygear_worker_serve(pygear_WorkerObject* self, PyObject* args, PyObject* kwargs);
+PyDoc_STRVAR(pygear_worker_serve_doc,
+"Fork a number of child processes that each run their own 'work' loop on a\n"
+"fresh connection, using the functions added to this worker. The parent\n"
+"restarts children that die, or that have done 'max_jobs_per_child' jobs,\n"
+"which caps memory growth from leaky job functions. Add functions before\n"
+"calling this, since children only see what was registered at fork time.\n\n"
+"Blocks until a signal raises an exception in the parent (Ctrl-C, or a\n"
+"SIGTERM handler raising SystemExit). Children are then sent SIGTERM, finish\n"
+"their current job and exit, and the exception is re-raised.\n\n"
+"@param[in] processes - Number of child processes to keep running.\n"
+"@param[in] max_jobs_per_child - Jobs a child does before it is replaced.\n"
+"\tA value of 0 (the default) means no limit.\n\n"
+"@raises the exception that stopped the parent.\n\n"
+"Example:\n"
+"w.add_function('reverse', 0, reverse)\n"
+"w.serve(processes=8, max_jobs_per_child=10000)");
+
+static PyObject* pygear_worker_serve_stats(pygear_WorkerObject* self);
+PyDoc_STRVAR(pygear_worker_serve_stats_doc,
+"Get job counters for the children of the last 'serve' call. The GIL is\n"
+"released while 'serve' waits, so this can be called from another thread.\n\n"
+"@return a list with one dictionary per child slot with the keys:\n"
+"'pid': int - Process id of the current child (0 if none is running).\n"
+"'jobs': int - Jobs done by the current child.\n"
+"'total_jobs': int - Jobs done by every child that ran in this slot.\n"
+"'restarts': int - Number of times the child in this slot was replaced.");
 
 static PyObject* pygear_worker_set_timeout(pygear_WorkerObject* self, PyObject* args);
 PyDoc_STRVAR(pygear_worker_set_timeout_doc,
@@ -236,11 +302,28 @@ PyDoc_STRVAR(pygear_worker_wait_doc,
 "@return None on success.\n"
 "@return NULL and raises pygear exception on failure.");
 
+static PyObject* pygear_worker_fileno(pygear_WorkerObject* self);
+PyDoc_STRVAR(pygear_worker_fileno_doc,
+"Return a file descriptor that becomes readable when 'step' can make\n"
+"progress, for use with select() or an event loop. A helper thread waits on\n"
+"the job server connections while the worker is idle between steps.\n"
+"Drive the worker only through 'step' while using it: 'work' pauses the\n"
+"notifications until the next 'step'.\n\n"
+"@return the file descriptor.");
+
+static PyObject* pygear_worker_step(pygear_WorkerObject* self);
+PyDoc_STRVAR(pygear_worker_step_doc,
+"Run the jobs that are available right now without blocking for new ones.\n"
+"Call it once to start and then whenever 'fileno' is readable.\n\n"
+"@return the number of jobs run.\n"
+"@raises pygear exception on failure.\n");
+
 static PyObject* pygear_worker_work(pygear_WorkerObject* self);
 PyDoc_STRVAR(pygear_worker_work_doc,
 "Wait for a job and call the appropriate function when it gets one.\n"
-"Note that this may run for an indefinite time and blocks KeyboardInterrupt\n"
-"from the python interpreter. Call 'set_timeout' beforehand to avoid this.\n\n"
+"The GIL is released while waiting, so other python threads keep running.\n"
+"Signal handlers still run while waiting, so Ctrl-C interrupts it promptly.\n"
+"Call 'set_timeout' beforehand to give up after a while without a job.\n\n"
 "@raises pygear exception on failure.\n");
 
 static PyObject* pygear_worker_unregister(pygear_WorkerObject* self, PyObject* args);
@@ -276,15 +359,20 @@ static PyMethodDef worker_module_methods[] = {
     _WORKERMETHOD(grab_job,         METH_NOARGS)
     _WORKERMETHOD(job_free_all,     METH_NOARGS)
     _WORKERMETHOD(function_exists,  METH_VARARGS)
-    _WORKERMETHOD(add_function,     METH_VARARGS)
+    _WORKERMETHOD(add_function,     METH_VARARGS | METH_KEYWORDS)
     _WORKERMETHOD(work,             METH_NOARGS)
+    _WORKERMETHOD(step,             METH_NOARGS)
+    _WORKERMETHOD(fileno,           METH_NOARGS)
+    _WORKERMETHOD(serve,            METH_VARARGS | METH_KEYWORDS)
+    _WORKERMETHOD(serve_stats,      METH_NOARGS)
     _WORKERMETHOD(echo,             METH_VARARGS)
     _WORKERMETHOD(id,               METH_NOARGS)
     _WORKERMETHOD(set_identifier,   METH_VARARGS)
     _WORKERMETHOD(set_namespace,    METH_VARARGS)
     _WORKERMETHOD(namespace,        METH_NOARGS)
     _WORKERMETHOD(set_log_fn,       METH_VARARGS)
-    _WORKERMETHOD(set_serializer,   METH_VARARGS)
+    _WORKERMETHOD(set_serializer,   METH_VARARGS | METH_KEYWORDS)
+    _WORKERMETHOD(set_compression,  METH_VARARGS | METH_KEYWORDS)
     {NULL, NULL, 0, NULL}
 };
 
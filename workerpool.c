@@ -0,0 +1,282 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <sys/time.h>
+#include "workerpool.h"
+
+/* How long (in milliseconds) the calling thread sleeps between signal checks
+ * while the pool is running */
+#define PYGEAR_WORKERPOOL_SIGNAL_MSEC 100
+
+/*
+ * Class constructor / destructor methods
+ */
+
+int WorkerPool_init(pygear_WorkerPoolObject* self, PyObject* args, PyObject* kwds) {
+    int n_threads;
+    if (!PyArg_ParseTuple(args, "i", &n_threads)) {
+        return -1;
+    }
+    if (n_threads < 1) {
+        PyErr_SetString(PyExc_ValueError, "WorkerPool needs at least one thread");
+        return -1;
+    }
+    if (self->running) {
+        PyErr_SetString(PyGearExn_ERROR, "Cannot re-initialize a running WorkerPool");
+        return -1;
+    }
+    if (self->slots) {
+        free(self->slots);
+    } else {
+        pthread_mutex_init(&self->lock, NULL);
+        pthread_cond_init(&self->cond, NULL);
+    }
+    self->slots = calloc(n_threads, sizeof(pygear_workerpool_slot));
+    if (self->slots == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->n_threads = n_threads;
+    self->stopping = 0;
+    self->live_threads = 0;
+    return 0;
+}
+
+int WorkerPool_traverse(pygear_WorkerPoolObject* self, visitproc visit, void* arg) {
+    Py_VISIT(self->worker);
+    Py_VISIT(self->err_type);
+    Py_VISIT(self->err_value);
+    Py_VISIT(self->err_traceback);
+    return 0;
+}
+
+int WorkerPool_clear(pygear_WorkerPoolObject* self) {
+    Py_CLEAR(self->worker);
+    Py_CLEAR(self->err_type);
+    Py_CLEAR(self->err_value);
+    Py_CLEAR(self->err_traceback);
+    return 0;
+}
+
+void WorkerPool_dealloc(pygear_WorkerPoolObject* self) {
+    if (self->slots) {
+        free(self->slots);
+        self->slots = NULL;
+        pthread_mutex_destroy(&self->lock);
+        pthread_cond_destroy(&self->cond);
+    }
+    WorkerPool_clear(self);
+    self->ob_type->tp_free((PyObject*)self);
+}
+
+/*******************
+ * Private methods *
+ *******************/
+
+/*
+ * Called with the GIL held and an exception set. Keeps the first error seen
+ * by any thread so 'work' can raise it, and asks the pool to stop.
+ */
+static void _pygear_workerpool_fail(pygear_WorkerPoolObject* pool) {
+    if (pool->err_type == NULL) {
+        PyErr_Fetch(&pool->err_type, &pool->err_value, &pool->err_traceback);
+    } else {
+        PyErr_Clear();
+    }
+    pool->stopping = 1;
+}
+
+static void* _pygear_workerpool_thread(void* arg) {
+    pygear_workerpool_slot* slot = (pygear_workerpool_slot*) arg;
+    pygear_WorkerPoolObject* pool = slot->pool;
+
+    // Create this thread's state once, so the PyGILState_Ensure in the
+    // function mapper finds it instead of building a new one for every job
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    PyThreadState* tstate = PyEval_SaveThread();
+
+    while (!pool->stopping) {
+        gearman_return_t result = gearman_worker_work(slot->g_Worker);
+        // Only this thread touches its own exception state, so it is safe
+        // to peek at it without the GIL
+        if (tstate->curexc_type == NULL && (result == GEARMAN_SUCCESS ||
+            result == GEARMAN_TIMEOUT || result == GEARMAN_IO_WAIT ||
+            result == GEARMAN_NO_JOBS)) {
+            continue;
+        }
+        PyEval_RestoreThread(tstate);
+        if (PyErr_Occurred()) {
+            // Job function errors have already been printed and sent back to
+            // the client by the function mapper; only exit requests stop the pool
+            if (PyErr_ExceptionMatches(PyExc_KeyboardInterrupt) ||
+                PyErr_ExceptionMatches(PyExc_SystemExit)) {
+                _pygear_workerpool_fail(pool);
+            } else {
+                PyErr_Clear();
+            }
+        } else if (_pygear_check_and_raise_exn(result)) {
+            _pygear_workerpool_fail(pool);
+        }
+        tstate = PyEval_SaveThread();
+    }
+
+    PyEval_RestoreThread(tstate);
+    PyGILState_Release(gstate);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->live_threads--;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/*
+ * Block until every pool thread has exited, checking for signals in between
+ * so Ctrl-C stops the pool. Called with the GIL held.
+ */
+static void _pygear_workerpool_wait(pygear_WorkerPoolObject* self) {
+    int live_threads = 1;
+    while (live_threads > 0) {
+        Py_BEGIN_ALLOW_THREADS
+        struct timeval now;
+        struct timespec deadline;
+        gettimeofday(&now, NULL);
+        long nsec = now.tv_usec * 1000L + PYGEAR_WORKERPOOL_SIGNAL_MSEC * 1000000L;
+        deadline.tv_sec = now.tv_sec + nsec / 1000000000L;
+        deadline.tv_nsec = nsec % 1000000000L;
+        pthread_mutex_lock(&self->lock);
+        if (self->live_threads > 0) {
+            pthread_cond_timedwait(&self->cond, &self->lock, &deadline);
+        }
+        live_threads = self->live_threads;
+        pthread_mutex_unlock(&self->lock);
+        Py_END_ALLOW_THREADS
+        if (live_threads > 0 && !self->stopping && PyErr_CheckSignals()) {
+            _pygear_workerpool_fail(self);
+        }
+    }
+}
+
+/********************
+ * Instance methods *
+ ********************
+ */
+
+static PyObject* pygear_workerpool_size(pygear_WorkerPoolObject* self) {
+    return Py_BuildValue("i", self->n_threads);
+}
+
+
+static PyObject* pygear_workerpool_stop(pygear_WorkerPoolObject* self) {
+    self->stopping = 1;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* pygear_workerpool_work(pygear_WorkerPoolObject* self, PyObject* args) {
+    pygear_WorkerObject* worker;
+    if (!PyArg_ParseTuple(args, "O!", &pygear_WorkerType, &worker)) {
+        return NULL;
+    }
+    if (self->slots == NULL) {
+        PyErr_SetString(PyGearExn_ERROR, "WorkerPool has not been initialized");
+        return NULL;
+    }
+    if (self->running) {
+        PyErr_SetString(PyGearExn_ERROR, "WorkerPool is already running");
+        return NULL;
+    }
+    int timeout = gearman_worker_timeout(worker->g_Worker);
+    if (timeout < 0 || timeout > PYGEAR_WORKERPOOL_POLL_MSEC) {
+        timeout = PYGEAR_WORKERPOOL_POLL_MSEC;
+    }
+
+    int i;
+    for (i = 0; i < self->n_threads; ++i) {
+        pygear_workerpool_slot* slot = &self->slots[i];
+        slot->pool = self;
+        slot->started = 0;
+        slot->g_Worker = _pygear_worker_clone_connection(worker);
+        if (slot->g_Worker == NULL) {
+            PyErr_SetString(PyGearExn_ERROR, "Failed to create internal gearman worker structure.");
+            goto cleanup;
+        }
+        gearman_worker_set_timeout(slot->g_Worker, timeout);
+    }
+
+    Py_INCREF(worker);
+    self->worker = worker;
+    self->running = 1;
+    self->stopping = 0;
+    for (i = 0; i < self->n_threads; ++i) {
+        pthread_mutex_lock(&self->lock);
+        int rc = pthread_create(&self->slots[i].thread, NULL, _pygear_workerpool_thread, &self->slots[i]);
+        if (rc == 0) {
+            self->slots[i].started = 1;
+            self->live_threads++;
+        }
+        pthread_mutex_unlock(&self->lock);
+        if (!self->slots[i].started) {
+            // pthread_create returns its error instead of setting errno
+            errno = rc;
+            PyErr_SetFromErrno(PyExc_OSError);
+            _pygear_workerpool_fail(self);
+            break;
+        }
+    }
+    _pygear_workerpool_wait(self);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < self->n_threads; ++i) {
+        if (self->slots[i].started) {
+            pthread_join(self->slots[i].thread, NULL);
+            self->slots[i].started = 0;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    self->running = 0;
+    Py_CLEAR(self->worker);
+
+cleanup:
+    for (i = 0; i < self->n_threads; ++i) {
+        if (self->slots[i].g_Worker) {
+            gearman_worker_free(self->slots[i].g_Worker);
+            self->slots[i].g_Worker = NULL;
+        }
+    }
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+    if (self->err_type) {
+        PyErr_Restore(self->err_type, self->err_value, self->err_traceback);
+        self->err_type = self->err_value = self->err_traceback = NULL;
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
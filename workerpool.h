@@ -0,0 +1,163 @@
+/*
+ *
+ * Copyright (c) 2014, Yelp Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Yelp Inc. nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL YELP INC. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Python.h>
+#include <libgearman-1.0/gearman.h>
+#include <pthread.h>
+#include <stdio.h>
+#include "structmember.h"
+#include "worker.h"
+#include "exception.h"
+
+#ifndef PyMODINIT_FUNC
+#define PyMODINIT_FUNC void
+#endif
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#define _WORKERPOOLMETHOD(name,flags) {#name,(PyCFunction) pygear_workerpool_##name,flags,pygear_workerpool_##name##_doc},
+
+/* Upper bound (in milliseconds) on how long a pool thread waits for a job
+ * before checking whether the pool has been asked to stop */
+#define PYGEAR_WORKERPOOL_POLL_MSEC 500
+
+struct pygear_WorkerPoolObject;
+
+typedef struct {
+    struct pygear_WorkerPoolObject* pool;
+    struct gearman_worker_st* g_Worker;
+    pthread_t thread;
+    int started;
+} pygear_workerpool_slot;
+
+typedef struct pygear_WorkerPoolObject {
+    PyObject_HEAD
+    int n_threads;
+    pygear_workerpool_slot* slots;
+    pygear_WorkerObject* worker;
+    volatile int stopping;
+    int running;
+    int live_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    PyObject* err_type;
+    PyObject* err_value;
+    PyObject* err_traceback;
+} pygear_WorkerPoolObject;
+
+PyDoc_STRVAR(workerpool_module_docstring,
+"Runs the functions registered on a Worker from several OS threads, each\n"
+"with its own connection to the job servers.");
+
+/* Class init methods */
+int WorkerPool_init(pygear_WorkerPoolObject *self, PyObject *args, PyObject *kwds);
+int WorkerPool_traverse(pygear_WorkerPoolObject *self,  visitproc visit, void *arg);
+int WorkerPool_clear(pygear_WorkerPoolObject* self);
+void WorkerPool_dealloc(pygear_WorkerPoolObject* self);
+
+/* Method definitions */
+static PyObject* pygear_workerpool_size(pygear_WorkerPoolObject* self);
+PyDoc_STRVAR(pygear_workerpool_size_doc,
+"Get the number of threads in the pool.\n\n"
+"@return integer.");
+
+static PyObject* pygear_workerpool_stop(pygear_WorkerPoolObject* self);
+PyDoc_STRVAR(pygear_workerpool_stop_doc,
+"Ask every pool thread to exit once its current job is done. Safe to call\n"
+"from a job function or from another python thread.");
+
+static PyObject* pygear_workerpool_work(pygear_WorkerPoolObject* self, PyObject* args);
+PyDoc_STRVAR(pygear_workerpool_work_doc,
+"Serve jobs for a configured Worker from every thread in the pool.\n"
+"Each thread clones the worker (servers, options and registered functions)\n"
+"and dispatches jobs through the worker's functions and serializer. Job\n"
+"functions run with the GIL held, so only functions that release it\n"
+"(I/O, C extensions) run in parallel.\n\n"
+"This blocks until 'stop' is called, a signal is raised, or a thread hits\n"
+"an error other than a timeout.\n\n"
+"@param[in] worker - Worker with servers and functions already added.\n\n"
+"@return None when stopped.\n"
+"@return NULL and raises the first error seen by any thread on failure.\n\n"
+"Example:\n"
+"w = pygear.Worker()\n"
+"w.add_server('localhost', 4730)\n"
+"w.add_function('reverse', 0, reverse)\n"
+"pygear.WorkerPool(8).work(w)");
+
+/* Module method specification */
+static PyMethodDef workerpool_module_methods[] = {
+    _WORKERPOOLMETHOD(size,         METH_NOARGS)
+    _WORKERPOOLMETHOD(stop,         METH_NOARGS)
+    _WORKERPOOLMETHOD(work,         METH_VARARGS)
+    {NULL, NULL, 0, NULL}
+};
+
+PyTypeObject pygear_WorkerPoolType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                                          /*ob_size*/
+    "pygear.WorkerPool",                        /*tp_name*/
+    sizeof(pygear_WorkerPoolObject),            /*tp_basicsize*/
+    0,                                          /*tp_itemsize*/
+    (destructor)WorkerPool_dealloc,             /*tp_dealloc*/
+    0,                                          /*tp_print*/
+    0,                                          /*tp_getattr*/
+    0,                                          /*tp_setattr*/
+    0,                                          /*tp_compare*/
+    0,                                          /*tp_repr*/
+    0,                                          /*tp_as_number*/
+    0,                                          /*tp_as_sequence*/
+    0,                                          /*tp_as_mapping*/
+    0,                                          /*tp_hash */
+    0,                                          /*tp_call*/
+    0,                                          /*tp_str*/
+    0,                                          /*tp_getattro*/
+    0,                                          /*tp_setattro*/
+    0,                                          /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT |
+    Py_TPFLAGS_BASETYPE |
+    Py_TPFLAGS_HAVE_GC,                         /*tp_flags*/
+    workerpool_module_docstring,                /* tp_doc */
+    (traverseproc)WorkerPool_traverse,          /* tp_traverse */
+    (inquiry)WorkerPool_clear,                  /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    0,                                          /* tp_iter */
+    0,                                          /* tp_iternext */
+    workerpool_module_methods,                  /* tp_methods */
+    0,                                          /* tp_members */
+    0,                                          /* tp_getset */
+    0,                                          /* tp_base */
+    0,                                          /* tp_dict */
+    0,                                          /* tp_descr_get */
+    0,                                          /* tp_descr_set */
+    0,                                          /* tp_dictoffset */
+    (initproc)WorkerPool_init,                  /* tp_init */
+};
+
+#endif